@@ -38,6 +38,15 @@ std::string pretty(Bitboard b);
 
 }  // namespace Stockfish::Bitboards
 
+namespace Bitbases {
+
+// KPK bitbase: returns true if the position with the white king on wksq, the
+// white pawn on wpsq (files A to D) and the black king on bksq is won for white
+void init();
+bool probe(Square wksq, Square wpsq, Square bksq, Color us);
+
+}  // namespace Stockfish::Bitbases
+
 constexpr Bitboard FileABB = 0x0101010101010101ULL;
 constexpr Bitboard FileBBB = FileABB << 1;
 constexpr Bitboard FileCBB = FileABB << 2;
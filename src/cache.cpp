@@ -0,0 +1,167 @@
+#include "cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "misc.h"
+
+namespace Stockfish {
+
+namespace {
+    constexpr uint64_t CACHE_MAGIC   = 0x4548434143534552ULL;  // "RESCACHE"
+    constexpr uint64_t CACHE_VERSION = 2;
+}
+
+ResultCache::~ResultCache() { release(); }
+
+void ResultCache::release() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (fd >= 0) {
+        munmap(memory, bytes);
+        close(fd);  // Also drops our lock on the file
+        fd = -1;
+    } else
+#endif
+        std::free(memory);
+
+    memory = nullptr;
+    header = nullptr;
+    buckets = nullptr;
+    bytes = 0;
+}
+
+bool ResultCache::resize(size_t mbSize, const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    release();
+
+    if (!mbSize)
+        return true;
+
+    uint64_t bucketCount = std::max<size_t>(mbSize * 1024 * 1024 / sizeof(Bucket), 1);
+    bytes = sizeof(Header) + bucketCount * sizeof(Bucket);
+
+    if (path.empty()) {
+        memory = static_cast<char*>(std::calloc(1, bytes));
+        if (!memory) {
+            std::cerr << "Failed to allocate " << mbSize << "MB for the result cache." << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    } else {
+#if defined(__unix__) || defined(__APPLE__)
+        fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0 || flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            std::cerr << "Cannot open result cache " << path << ", or it is in use." << std::endl;
+            if (fd >= 0)
+                close(fd);
+            fd = -1;
+            bytes = 0;
+            return false;
+        }
+
+        // A file of another size is emptied and resized, which zeroes it
+        struct stat st {};
+        bool ok = fstat(fd, &st) == 0;
+        if (ok && size_t(st.st_size) != bytes)
+            ok = ftruncate(fd, 0) == 0 && ftruncate(fd, off_t(bytes)) == 0;
+
+        void* mem = ok ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        if (mem == MAP_FAILED) {
+            std::cerr << "Cannot map result cache " << path << "." << std::endl;
+            close(fd);
+            fd = -1;
+            bytes = 0;
+            return false;
+        }
+        memory = static_cast<char*>(mem);
+#else
+        std::cerr << "A result cache file needs POSIX file mapping." << std::endl;
+        bytes = 0;
+        return false;
+#endif
+    }
+
+    header = reinterpret_cast<Header*>(memory);
+    buckets = reinterpret_cast<Bucket*>(memory + sizeof(Header));
+
+    // Anything but a cache of the same layout and size starts empty
+    if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION
+        || header->bucketCount != bucketCount) {
+        std::fill(memory, memory + bytes, 0);
+        *header = {CACHE_MAGIC, CACHE_VERSION, bucketCount, 0};
+    }
+
+    return true;
+}
+
+// Mixes the context into the position key, so that the searches of one
+// position with different limits, options or history are different entries
+uint64_t ResultCache::entry_key(Key key, uint64_t context) {
+    uint64_t h = context * 0x9E3779B97F4A7C15ULL;
+    return key ^ (h ^ (h >> 29));
+}
+
+bool ResultCache::probe(Key key, uint64_t context, Search::SearchResult& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!memory)
+        return false;
+
+    uint64_t k = entry_key(key, context);
+    Bucket&  bucket = buckets[mul_hi64(k, header->bucketCount)];
+
+    for (Entry& e : bucket.entries)
+        if (e.key == k && e.pvLength) {
+            e.lastUse = ++header->clock;
+
+            result.bestMove = Move(e.pv[0]);
+            result.score = Value(e.score);
+            result.depth = e.depth;
+            result.nodes = e.nodes;
+            result.pv.clear();
+            for (int i = 0; i < e.pvLength; ++i)
+                result.pv.push_back(Move(e.pv[i]));
+            return true;
+        }
+
+    return false;
+}
+
+void ResultCache::store(Key key, uint64_t context, const Search::SearchResult& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!memory || result.pv.empty())
+        return;
+
+    uint64_t k = entry_key(key, context);
+    Bucket&  bucket = buckets[mul_hi64(k, header->bucketCount)];
+
+    // The entry of the same key, or else the least recently used one,
+    // empty entries having never been used
+    Entry* replace = &bucket.entries[0];
+    for (Entry& e : bucket.entries) {
+        if (e.key == k) {
+            replace = &e;
+            break;
+        }
+        if (e.lastUse < replace->lastUse)
+            replace = &e;
+    }
+
+    replace->key = k;
+    replace->nodes = result.nodes;
+    replace->lastUse = ++header->clock;
+    replace->score = int16_t(result.score);
+    replace->depth = uint8_t(result.depth);
+    replace->pvLength = uint8_t(std::min<size_t>(result.pv.size(), MAX_PV));
+    for (int i = 0; i < replace->pvLength; ++i)
+        replace->pv[i] = result.pv[i].raw();
+}
+
+}  // namespace Stockfish
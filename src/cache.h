@@ -0,0 +1,78 @@
+#ifndef CACHE_H_INCLUDED
+#define CACHE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "search.h"
+#include "types.h"
+
+namespace Stockfish {
+
+// Results of whole searches, keyed by the root position and a hash of the
+// rest of the search context (limits, options and the game history that
+// matters), so that a repeated request is answered without searching. The
+// cache is set associative: each key maps to a bucket of a few entries,
+// and storing into a full bucket replaces its least recently used entry.
+// Principal variations are kept up to MAX_PV moves.
+//
+// The entries live in memory, or in a file mapped into memory that keeps
+// them across runs. A file is used by one process at a time, and one
+// written for another cache size is started afresh.
+class ResultCache {
+   public:
+    static constexpr int MAX_PV = 18;
+
+    ~ResultCache();
+
+    // Sizes the cache, 0 disabling it. Returns false if the file at path
+    // cannot be used, in which case the cache is disabled.
+    bool resize(size_t mbSize, const std::string& path = "");
+
+    bool probe(Key key, uint64_t context, Search::SearchResult& result);
+    void store(Key key, uint64_t context, const Search::SearchResult& result);
+
+   private:
+    struct Entry {
+        uint64_t key;  // Position key xored with the hashed context, 0 when empty
+        uint64_t nodes;
+        uint64_t lastUse;
+        int16_t  score;
+        uint8_t  depth;
+        uint8_t  pvLength;
+        uint16_t pv[MAX_PV];
+    };
+
+    static constexpr int BUCKET_SIZE = 8;
+
+    struct Bucket {
+        Entry entries[BUCKET_SIZE];
+    };
+
+    // Start of the memory, also of the file: the use counter of the LRU
+    // policy survives restarts with the entries
+    struct Header {
+        uint64_t magic;
+        uint64_t version;
+        uint64_t bucketCount;
+        uint64_t clock;
+    };
+
+    static_assert(sizeof(Entry) == 64, "Cache entries fill a cache line");
+
+    static uint64_t entry_key(Key key, uint64_t context);
+    void            release();
+
+    std::mutex mutex;
+    char*      memory  = nullptr;
+    size_t     bytes   = 0;
+    Header*    header  = nullptr;
+    Bucket*    buckets = nullptr;
+    int        fd      = -1;  // Mapped file, -1 for memory of our own
+};
+
+}  // namespace Stockfish
+
+#endif // CACHE_H_INCLUDED
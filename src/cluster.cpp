@@ -0,0 +1,385 @@
+#include "cluster.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <deque>
+#include <iostream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <cerrno>
+    #include <netdb.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+#include "movegen.h"
+#include "position.h"
+
+namespace Stockfish::Cluster {
+
+#if defined(__unix__) || defined(__APPLE__)
+
+namespace {
+    // A connected socket, with the bytes received after the last full line
+    class Connection {
+    public:
+        explicit Connection(int socketFd) : fd(socketFd) {}
+        Connection(Connection&& other) noexcept : fd(other.fd), buffer(std::move(other.buffer)) {
+            other.fd = -1;
+        }
+        Connection& operator=(Connection&& other) noexcept {
+            std::swap(fd, other.fd);
+            std::swap(buffer, other.buffer);
+            return *this;
+        }
+        ~Connection() {
+            if (fd >= 0)
+                close(fd);
+        }
+
+        int socket() const { return fd; }
+
+        bool send_line(const std::string& line) {
+            std::string data = line + "\n";
+            for (size_t sent = 0; sent < data.size();) {
+                ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, 0);
+                if (n <= 0)
+                    return false;
+                sent += size_t(n);
+            }
+            return true;
+        }
+
+        // Appends what the peer sent to the buffer. Returns false at the end
+        // of the stream or on error.
+        bool receive() {
+            char    chunk[4096];
+            ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n <= 0)
+                return false;
+            buffer.append(chunk, size_t(n));
+            return true;
+        }
+
+        // Takes the next full line out of the buffer
+        bool next_line(std::string& line) {
+            size_t end = buffer.find('\n');
+            if (end == std::string::npos)
+                return false;
+            line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            return true;
+        }
+
+    private:
+        int         fd;
+        std::string buffer;
+    };
+
+    // Opens a socket listening on address, or connected to it. Paths and
+    // addresses without a port are Unix domain sockets. Returns -1 on error.
+    int open_socket(const std::string& address, bool listening) {
+        size_t colon = address.rfind(':');
+
+        if (address.empty() || address[0] == '/' || address[0] == '.' || colon == std::string::npos) {
+            sockaddr_un sa{};
+            sa.sun_family = AF_UNIX;
+            if (address.size() >= sizeof(sa.sun_path))
+                return -1;
+            std::copy(address.begin(), address.end(), sa.sun_path);
+
+            int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+                return -1;
+
+            if (listening)
+                unlink(address.c_str());
+
+            bool ok = listening ? bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0
+                                    && listen(fd, 4) == 0
+                                : connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0;
+            if (!ok) {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        std::string host = address.substr(0, colon);
+        std::string port = address.substr(colon + 1);
+
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+        addrinfo* addresses;
+        if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses) != 0)
+            return -1;
+
+        int fd = -1;
+        for (addrinfo* ai = addresses; ai && fd < 0; ai = ai->ai_next) {
+            fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0)
+                continue;
+
+            int one = 1;
+            if (listening)
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            bool ok = listening ? bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 4) == 0
+                                : connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+            if (!ok) {
+                close(fd);
+                fd = -1;
+            } else if (!listening)
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        freeaddrinfo(addresses);
+        return fd;
+    }
+
+    int elapsed_ms(std::chrono::steady_clock::time_point start) {
+        return int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Worker side of a search request: iterative deepening up to depth
+    std::string answer(Search::FixedDepthSearch& fixedSearch, const std::string& fen, int depth,
+                       int timeMs) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodesBefore = fixedSearch.nodes();
+
+        StateInfo si;
+        Position pos;
+        pos.set(fen, false, &si);
+
+        Value value = VALUE_ZERO;
+        for (int d = 0; d <= depth; ++d) {
+            value = fixedSearch.search(pos, d, std::max(timeMs - elapsed_ms(start), 0));
+            if (fixedSearch.stopped())
+                return "stopped " + std::to_string(fixedSearch.nodes() - nodesBefore);
+        }
+
+        return "score " + std::to_string(value) + " "
+             + std::to_string(fixedSearch.nodes() - nodesBefore);
+    }
+}
+
+bool serve(const std::string& address) {
+    // A coordinator going away must not kill the worker
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int listenFd = open_socket(address, true);
+    if (listenFd < 0)
+        return false;
+
+    Search::FixedDepthSearch fixedSearch;
+    bool quit = false;
+
+    while (!quit) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        Connection conn(fd);
+        std::string line;
+
+        while (!quit) {
+            if (!conn.next_line(line)) {
+                if (!conn.receive())
+                    break;
+                continue;
+            }
+
+            std::istringstream is(line);
+            std::string command, fen;
+            int depth = 0, timeMs = 0;
+            is >> command;
+
+            if (command == "quit")
+                quit = true;
+            else if (command == "search" && is >> depth >> timeMs && std::getline(is >> std::ws, fen)) {
+                if (!conn.send_line(answer(fixedSearch, fen, depth, timeMs)))
+                    break;
+            }
+        }
+    }
+
+    close(listenFd);
+    return true;
+}
+
+Search::SearchResult search(Position& pos, const std::vector<std::string>& workers, int maxDepth,
+                            int timeMs) {
+    std::signal(SIGPIPE, SIG_IGN);
+
+    auto start = std::chrono::steady_clock::now();
+    Search::SearchResult result{Move::none(), VALUE_ZERO, 0, 0, {}, 0};
+
+    // Workers with the index of the root move they are searching, -1 when idle
+    struct Peer {
+        Connection conn;
+        int        task;
+    };
+    std::vector<Peer> peers;
+
+    for (const std::string& address : workers) {
+        int fd = open_socket(address, false);
+        if (fd < 0)
+            std::cerr << "Cannot connect to worker " << address << std::endl;
+        else
+            peers.push_back({Connection(fd), -1});
+    }
+
+    // Root moves with the position they lead to, best first after each
+    // iteration
+    struct RootEntry {
+        Move        move;
+        std::string fen;
+        Value       score;
+    };
+    std::vector<RootEntry> roots;
+
+    for (Move m : MoveList<LEGAL>(pos)) {
+        StateInfo st;
+        pos.do_move(m, st, nullptr);
+        roots.push_back({m, pos.fen(), -VALUE_INFINITE});
+        pos.undo_move(m);
+    }
+
+    for (int depth = 1; depth <= maxDepth && depth < MAX_PLY && !roots.empty(); ++depth) {
+        std::deque<int> queue;
+        for (size_t i = 0; i < roots.size(); ++i)
+            queue.push_back(int(i));
+
+        std::vector<Value> scores(roots.size(), -VALUE_INFINITE);
+        size_t done = 0;
+        bool stopped = false;
+
+        // A worker that fails gives its move back to the queue
+        auto drop = [&](Peer& peer) {
+            if (peer.task >= 0)
+                queue.push_front(peer.task);
+            peer.conn = Connection(-1);
+            peer.task = -1;
+        };
+
+        while (done < roots.size() && !stopped) {
+            for (Peer& peer : peers)
+                if (peer.task < 0 && !queue.empty()) {
+                    peer.task = queue.front();
+                    queue.pop_front();
+
+                    std::string request = "search " + std::to_string(depth - 1) + " "
+                                        + std::to_string(std::max(timeMs - elapsed_ms(start), 0))
+                                        + " " + roots[peer.task].fen;
+                    if (!peer.conn.send_line(request))
+                        drop(peer);
+                }
+
+            peers.erase(std::remove_if(peers.begin(), peers.end(),
+                                       [](const Peer& p) { return p.conn.socket() < 0; }),
+                        peers.end());
+            if (peers.empty()) {
+                std::cerr << "No worker left" << std::endl;
+                break;
+            }
+
+            std::vector<pollfd> fds;
+            for (Peer& peer : peers)
+                fds.push_back({peer.conn.socket(), POLLIN, 0});
+
+            int ready = poll(fds.data(), fds.size(), std::max(timeMs - elapsed_ms(start), 0));
+            if (ready == 0) {
+                stopped = true;
+                break;
+            }
+            if (ready < 0)
+                continue;
+
+            for (size_t i = 0; i < peers.size(); ++i) {
+                if (!fds[i].revents)
+                    continue;
+
+                Peer& peer = peers[i];
+                if (!peer.conn.receive()) {
+                    drop(peer);
+                    continue;
+                }
+
+                std::string line;
+                while (peer.task >= 0 && peer.conn.next_line(line)) {
+                    std::istringstream is(line);
+                    std::string reply;
+                    uint64_t nodes = 0;
+                    is >> reply;
+
+                    if (reply == "score") {
+                        int value;
+                        is >> value >> nodes;
+
+                        // Mate scores are one ply further from our root
+                        Value score = -Value(value);
+                        score = is_win(score) ? score - 1 : is_loss(score) ? score + 1 : score;
+                        scores[peer.task] = score;
+                        ++done;
+                    } else
+                        stopped = true;
+
+                    result.nodes += nodes;
+                    peer.task = -1;
+                }
+            }
+
+            peers.erase(std::remove_if(peers.begin(), peers.end(),
+                                       [](const Peer& p) { return p.conn.socket() < 0; }),
+                        peers.end());
+        }
+
+        // An interrupted iteration is discarded
+        if (done < roots.size())
+            break;
+
+        for (size_t i = 0; i < roots.size(); ++i)
+            roots[i].score = scores[i];
+        std::stable_sort(roots.begin(), roots.end(),
+                         [](const RootEntry& a, const RootEntry& b) { return a.score > b.score; });
+
+        result.bestMove = roots[0].move;
+        result.score = roots[0].score;
+        result.depth = depth;
+        result.pv = {roots[0].move};
+
+        if (result.score >= VALUE_MATE_IN_MAX_PLY || result.score <= -VALUE_MATE_IN_MAX_PLY)
+            break;
+    }
+
+    result.elapsedMs = elapsed_ms(start);
+    return result;
+}
+
+#else
+
+bool serve(const std::string&) { return false; }
+
+Search::SearchResult search(Position&, const std::vector<std::string>&, int, int) {
+    std::cerr << "Cluster search needs POSIX sockets" << std::endl;
+    return {Move::none(), VALUE_ZERO, 0, 0, {}, 0};
+}
+
+#endif
+
+}  // namespace Stockfish::Cluster
@@ -0,0 +1,40 @@
+#ifndef CLUSTER_H_INCLUDED
+#define CLUSTER_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include "search.h"
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+
+// Root splitting across engine processes. A coordinator hands the positions
+// after each root move to worker processes, one at a time, and gives a new
+// one to each worker that returns a score. Addresses are "host:port" for
+// TCP or a filesystem path for a Unix domain socket.
+//
+// The protocol is line based text:
+//   search <depth> <time_ms> <fen>   Coordinator asks for a score of fen
+//   score <value> <nodes>            Worker answers for the side to move
+//   stopped <nodes>                  Worker ran out of time
+//   quit                             Coordinator shuts the worker down
+namespace Cluster {
+
+// Serves coordinators on address, one connection at a time, until one of
+// them sends quit. Returns false if address cannot be listened on.
+bool serve(const std::string& address);
+
+// Iterative deepening over the root moves of pos, each iteration splitting
+// them among the workers, best moves of the previous iteration first. A
+// worker that drops out has its move handed to another one. The result is
+// the one of the last iteration completed within timeMs.
+Search::SearchResult search(Position& pos, const std::vector<std::string>& workers, int maxDepth,
+                            int timeMs);
+
+}  // namespace Cluster
+
+}  // namespace Stockfish
+
+#endif // CLUSTER_H_INCLUDED
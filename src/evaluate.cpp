@@ -107,8 +107,49 @@ Value psqt_value(Piece pc, Square s) {
     return c == WHITE ? value : -value;
 }
 
+// Material keys of KPK with white and with black as the strong side
+Key kpkKey[COLOR_NB];
+
+// Score of a won KPK position. It stays below the value of a queen so that
+// promoting still looks like progress, and grows as the pawn advances.
+constexpr Value KpkWin = 500;
+
+void init() {
+    for (Color c : {WHITE, BLACK}) {
+        StateInfo st;
+        Position pos;
+        kpkKey[c] = pos.set("KPvK", c, &st).material_key();
+    }
+}
+
+// King and pawn versus king, scored exactly from the KPK bitbase
+Value evaluate_kpk(const Position& pos, Color strongSide) {
+    // The bitbase assumes the strong side is white with its pawn on files A-D
+    auto normalize = [&](Square s) {
+        if (file_of(pos.square<PAWN>(strongSide)) >= FILE_E)
+            s = flip_file(s);
+        return strongSide == WHITE ? s : flip_rank(s);
+    };
+    
+    Square strongKing = normalize(pos.square<KING>(strongSide));
+    Square strongPawn = normalize(pos.square<PAWN>(strongSide));
+    Square weakKing = normalize(pos.square<KING>(~strongSide));
+    Color us = strongSide == pos.side_to_move() ? WHITE : BLACK;
+    
+    if (!Bitbases::probe(strongKing, strongPawn, weakKing, us))
+        return VALUE_DRAW;
+    
+    Value result = KpkWin + 20 * rank_of(strongPawn);
+    return strongSide == pos.side_to_move() ? result : -result;
+}
+
 // Simple evaluation: material + piece-square tables
 Value evaluate(const Position& pos) {
+    if (pos.material_key() == kpkKey[WHITE])
+        return evaluate_kpk(pos, WHITE);
+    if (pos.material_key() == kpkKey[BLACK])
+        return evaluate_kpk(pos, BLACK);
+    
     Value score = VALUE_ZERO;
     
     // Evaluate all pieces on the board
@@ -9,6 +9,10 @@ class Position;
 
 namespace Eval {
 
+// Computes the material keys of the endings with exact knowledge.
+// Must be called after Position::init().
+void init();
+
 Value evaluate(const Position& pos);
 
 }  // namespace Eval
@@ -1,17 +1,25 @@
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <random>
 #include <chrono>
 #include <iomanip>
+#include <iterator>
 
 #include "types.h"
 #include "bitboard.h"
 #include "position.h"
 #include "movegen.h"
 #include "search.h"
+#include "mate.h"
+#include "mcts.h"
+#include "cluster.h"
+#include "pgn.h"
+#include "scheduler.h"
 #include "evaluate.h"
+#include "thread.h"
 
 using namespace Stockfish;
 
@@ -30,13 +38,25 @@ std::string move_to_uci(Move m) {
     uci += char('1' + rank_of(to));
     
     if (m.type_of() == PROMOTION) {
-        char promo[] = " nbrq";
-        uci += promo[m.promotion_type()];
+        uci += " pnbrqk"[m.promotion_type()];
     }
     
     return uci;
 }
 
+// Convert score to centipawns or a mate distance
+std::string score_to_string(Value score) {
+    if (score >= VALUE_MATE_IN_MAX_PLY)
+        return "Mate in " + std::to_string((VALUE_MATE - score + 1) / 2);
+    if (score <= -VALUE_MATE_IN_MAX_PLY)
+        return "Mated in " + std::to_string((VALUE_MATE + score) / 2);
+    if (is_win(score))
+        return "Tablebase win";
+    if (is_loss(score))
+        return "Tablebase loss";
+    return std::to_string(score);
+}
+
 // Analyze command: analyze position and return best move
 void cmd_analyze(const std::string& fen) {
     std::cout << "Analyzing FEN: " << fen << std::endl;
@@ -65,132 +85,494 @@ void cmd_analyze(const std::string& fen) {
     std::cout << "Search completed" << std::endl;
     
     // Print results
-    std::cout << "Evaluation: ";
-    if (result.score >= VALUE_MATE_IN_MAX_PLY)
-        std::cout << "Mate in " << (VALUE_MATE - result.score + 1) / 2 << std::endl;
-    else if (result.score <= -VALUE_MATE_IN_MAX_PLY)
-        std::cout << "Mated in " << (VALUE_MATE + result.score) / 2 << std::endl;
-    else
-        std::cout << result.score << std::endl;
+    std::cout << "Evaluation: " << score_to_string(result.score) << std::endl;
     
     std::cout << "Best move: " << move_to_uci(result.bestMove) << std::endl;
+    
+    std::cout << "PV:";
+    for (Move m : result.pv)
+        std::cout << " " << move_to_uci(m);
+    std::cout << std::endl;
+    
     std::cout << "Depth: " << result.depth << " Nodes: " << result.nodes << std::endl;
 }
 
-// Self-play command: generate games
+// Plays one self-play game and returns its PGN
+std::string play_game(int game, int maxPly, int whiteTimeMs, int blackTimeMs, unsigned seed,
+                      const std::string& date, int& totalDepth, int& totalMoves) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<> opening_moves(0, 100);
+    
+    Position pos;
+    StateInfo si;
+    std::vector<StateInfo> states(maxPly + 10);
+    
+    // Start from initial position
+    pos.set("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", false, &si);
+    
+    std::ostringstream out;
+    out << "[Event \"Engine Self-Play\"]" << std::endl;
+    out << "[Site \"Minimal Traditional Engine\"]" << std::endl;
+    out << "[Date \"" << date << "\"]" << std::endl;
+    out << "[Round \"" << (game + 1) << "\"]" << std::endl;
+    out << "[White \"MinimalEngine\"]" << std::endl;
+    out << "[Black \"MinimalEngine\"]" << std::endl;
+    
+    std::string pgn;
+    int ply = 0;
+    std::string result = "*";
+    
+    while (ply < maxPly) {
+        int timeMs = pos.side_to_move() == WHITE ? whiteTimeMs : blackTimeMs;
+        
+        // Add small randomization to opening moves
+        if (ply < 6 && opening_moves(gen) < 30) {
+            Move moveList[MAX_MOVES];
+            Move* last = generate<LEGAL>(pos, moveList);
+            
+            if (moveList == last) break;
+            
+            int legalMoves = last - moveList;
+            if (legalMoves == 0) break;
+            
+            std::uniform_int_distribution<> dist(0, legalMoves - 1);
+            Move randomMove = moveList[dist(gen)];
+            
+            if (ply % 2 == 0) {
+                pgn += std::to_string(ply / 2 + 1) + ". ";
+            }
+            pgn += move_to_uci(randomMove) + " ";
+            
+            pos.do_move(randomMove, states[ply], nullptr);
+            ply++;
+            continue;
+        }
+        
+        auto result_search = Search::search(pos, 10, timeMs);
+        totalDepth += result_search.depth;
+        totalMoves++;
+        
+        if (result_search.bestMove == Move::none()) {
+            // Game over
+            if (pos.checkers()) {
+                result = pos.side_to_move() == WHITE ? "0-1" : "1-0";
+            } else {
+                result = "1/2-1/2";
+            }
+            break;
+        }
+        
+        // Check for draw by fifty-move rule or repetition
+        if (pos.rule50_count() >= 100 || pos.is_draw(pos.game_ply())) {
+            result = "1/2-1/2";
+            break;
+        }
+        
+        if (ply % 2 == 0) {
+            pgn += std::to_string(ply / 2 + 1) + ". ";
+        }
+        pgn += move_to_uci(result_search.bestMove) + " ";
+        
+        pos.do_move(result_search.bestMove, states[ply], nullptr);
+        ply++;
+    }
+    
+    if (ply >= maxPly) {
+        result = "1/2-1/2";
+    }
+    
+    out << "[Result \"" << result << "\"]" << std::endl;
+    out << std::endl;
+    out << pgn << result << std::endl;
+    out << std::endl;
+    return out.str();
+}
+
+// Self-play command: generate games, played in parallel on the thread pool
 void cmd_play(int gameCount, int maxPly, int whiteTimeMs, int blackTimeMs) {
     std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> opening_moves(0, 100);
+    std::vector<unsigned> seeds(gameCount);
+    for (unsigned& seed : seeds)
+        seed = rd();
+    
+    auto now = std::chrono::system_clock::now();
+    auto time = std::chrono::system_clock::to_time_t(now);
+    std::ostringstream date;
+    date << std::put_time(std::localtime(&time), "%Y.%m.%d");
+    
+    std::vector<std::string> pgns(gameCount);
+    std::vector<int> depths(gameCount), moves(gameCount);
+    
+    Threads.parallel_for(0, gameCount, [&](size_t game) {
+        pgns[game] = play_game(int(game), maxPly, whiteTimeMs, blackTimeMs, seeds[game],
+                               date.str(), depths[game], moves[game]);
+    });
     
     int totalDepth = 0;
     int totalMoves = 0;
     
     for (int game = 0; game < gameCount; ++game) {
+        std::cout << pgns[game];
+        totalDepth += depths[game];
+        totalMoves += moves[game];
+    }
+    
+    if (totalMoves > 0) {
+        std::cout << "Average depth: " << (double)totalDepth / totalMoves << std::endl;
+    }
+}
+
+// Count the leaf nodes of the legal move tree
+uint64_t perft(Position& pos, int depth) {
+    MoveList<LEGAL> moves(pos);
+    if (depth <= 1)
+        return moves.size();
+    
+    uint64_t nodes = 0;
+    for (Move m : moves) {
+        StateInfo st;
+        pos.do_move(m, st, nullptr);
+        nodes += perft(pos, depth - 1);
+        pos.undo_move(m);
+    }
+    return nodes;
+}
+
+// Perft command: count nodes per root move, root moves split across the thread pool
+void cmd_perft(int depth, const std::string& fen) {
+    Position pos;
+    StateInfo si;
+    
+    try {
+        pos.set(fen, false, &si);
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting position: " << e.what() << std::endl;
+        return;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    
+    MoveList<LEGAL> rootMoves(pos);
+    std::vector<uint64_t> counts(rootMoves.size());
+    
+    Threads.parallel_for(0, rootMoves.size(), [&](size_t i) {
+        Position p;
+        StateInfo rootSt, st;
+        p.set(fen, false, &rootSt);
+        
+        Move m = rootMoves.begin()[i];
+        p.do_move(m, st, nullptr);
+        counts[i] = depth > 1 ? perft(p, depth - 1) : 1;
+    });
+    
+    uint64_t total = 0;
+    for (size_t i = 0; i < rootMoves.size(); ++i) {
+        std::cout << move_to_uci(rootMoves.begin()[i]) << ": " << counts[i] << std::endl;
+        total += counts[i];
+    }
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    
+    std::cout << std::endl << "Nodes searched: " << total << std::endl;
+    std::cout << "Time: " << elapsed << " ms" << std::endl;
+}
+
+// Batch command: analyze every FEN of a file (one per line), positions
+// searched in parallel on the thread pool
+void cmd_batch(const std::string& path, int timeMs) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Error: cannot open " << path << std::endl;
+        return;
+    }
+    
+    std::vector<std::string> fens;
+    for (std::string line; std::getline(in, line);)
+        if (!line.empty())
+            fens.push_back(line);
+    
+    std::vector<std::string> lines(fens.size());
+    
+    Threads.parallel_for(0, fens.size(), [&](size_t i) {
         Position pos;
         StateInfo si;
-        std::vector<StateInfo> states(maxPly + 10);
+        pos.set(fens[i], false, &si);
         
-        // Start from initial position
-        pos.set("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", false, &si);
+        auto result = Search::search(pos, MAX_PLY, timeMs);
         
-        std::cout << "[Event \"Engine Self-Play\"]" << std::endl;
-        std::cout << "[Site \"Minimal Traditional Engine\"]" << std::endl;
+        std::ostringstream ss;
+        ss << fens[i] << " | Best move: " << move_to_uci(result.bestMove)
+           << " | Evaluation: " << score_to_string(result.score)
+           << " | Depth: " << result.depth << " Nodes: " << result.nodes;
+        lines[i] = ss.str();
+    });
+    
+    for (const std::string& line : lines)
+        std::cout << line << std::endl;
+}
+
+// Mate command: prove or disprove a mate in at most maxMoves moves
+void cmd_mate(int maxMoves, const std::string& fen) {
+    Position pos;
+    StateInfo si;
+    
+    try {
+        pos.set(fen, false, &si);
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting position: " << e.what() << std::endl;
+        return;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    auto result = Mate::search(pos, maxMoves, Search::options.hashMB);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    
+    if (result.found) {
+        std::cout << "Mate in " << result.moves << ":";
+        for (Move m : result.line)
+            std::cout << " " << move_to_uci(m);
+        std::cout << std::endl;
+    } else
+        std::cout << "No mate in " << maxMoves << std::endl;
+    
+    std::cout << "Nodes: " << result.nodes << " Time: " << elapsed << " ms" << std::endl;
+}
+
+// MCTS command: explore the position for timeMs and print the visits and
+// win rate of the most visited root moves
+void cmd_mcts(int timeMs, const std::string& fen) {
+    Position pos;
+    StateInfo si;
+    
+    try {
+        pos.set(fen, false, &si);
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting position: " << e.what() << std::endl;
+        return;
+    }
+    
+    auto result = MCTS::search(pos, timeMs);
+    
+    for (size_t i = 0; i < result.moves.size() && i < 10; ++i)
+        std::cout << move_to_uci(result.moves[i].move) << " | Visits: " << result.moves[i].visits
+                  << " | Win rate: " << std::fixed << std::setprecision(1)
+                  << 100 * result.moves[i].winRate << "%" << std::endl;
+    
+    std::cout << "Playouts: " << result.playouts << std::endl;
+}
+
+// Coordinate command: search the position with its root moves split among
+// the worker processes listening on the comma separated addresses
+void cmd_coordinate(const std::string& addresses, int timeMs, const std::string& fen) {
+    Position pos;
+    StateInfo si;
+    
+    try {
+        pos.set(fen, false, &si);
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting position: " << e.what() << std::endl;
+        return;
+    }
+    
+    std::vector<std::string> workers;
+    std::stringstream ss(addresses);
+    for (std::string address; std::getline(ss, address, ',');)
+        if (!address.empty())
+            workers.push_back(address);
+    
+    auto result = Cluster::search(pos, workers, MAX_PLY, timeMs);
+    
+    std::cout << "Evaluation: " << score_to_string(result.score) << std::endl;
+    std::cout << "Best move: " << move_to_uci(result.bestMove) << std::endl;
+    std::cout << "Depth: " << result.depth << " Nodes: " << result.nodes << std::endl;
+}
+
+// Review command: analyse every position of each game of a PGN file, the
+// last one first, so that the transposition table left by the searches of
+// the later positions guides the searches of the earlier ones
+void cmd_review(const std::string& path, int timeMs) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Error: cannot open " << path << std::endl;
+        return;
+    }
+    
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string_view rest(text);
+    PGN::Game game;
+    
+    for (int gameNumber = 1; PGN::read_game(rest, game); ++gameNumber) {
+        std::cout << "Game " << gameNumber << ": " << game.tag("White") << " - "
+                  << game.tag("Black") << std::endl;
+        if (!game.complete)
+            std::cerr << "Warning: game " << gameNumber << " is only read up to its "
+                      << game.moves.size() << " first moves" << std::endl;
         
-        auto now = std::chrono::system_clock::now();
-        auto time = std::chrono::system_clock::to_time_t(now);
-        std::cout << "[Date \"" << std::put_time(std::localtime(&time), "%Y.%m.%d") << "\"]" << std::endl;
+        Position pos;
+        std::vector<StateInfo> states(game.moves.size() + 1);
+        try {
+            pos.set(game.fen, false, &states[0]);
+        } catch (const std::exception& e) {
+            std::cerr << "Error setting position: " << e.what() << std::endl;
+            continue;
+        }
         
-        std::cout << "[Round \"" << (game + 1) << "\"]" << std::endl;
-        std::cout << "[White \"MinimalEngine\"]" << std::endl;
-        std::cout << "[Black \"MinimalEngine\"]" << std::endl;
+        int startPly = pos.game_ply();
+        for (size_t ply = 0; ply < game.moves.size(); ++ply)
+            pos.do_move(game.moves[ply], states[ply + 1], nullptr);
         
-        std::string pgn;
-        int ply = 0;
-        std::string result = "*";
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = 0;
+        std::vector<Search::SearchResult> results(game.moves.size() + 1);
         
-        while (ply < maxPly) {
-            int timeMs = pos.side_to_move() == WHITE ? whiteTimeMs : blackTimeMs;
-            
-            // Add small randomization to opening moves
-            if (ply < 6 && opening_moves(gen) < 30) {
-                Move moveList[MAX_MOVES];
-                Move* last = generate<LEGAL>(pos, moveList);
-                
-                if (moveList == last) break;
-                
-                int legalMoves = last - moveList;
-                if (legalMoves == 0) break;
-                
-                std::uniform_int_distribution<> dist(0, legalMoves - 1);
-                Move randomMove = moveList[dist(gen)];
-                
-                if (ply % 2 == 0) {
-                    pgn += std::to_string(ply / 2 + 1) + ". ";
-                }
-                pgn += move_to_uci(randomMove) + " ";
-                
-                pos.do_move(randomMove, states[ply], nullptr);
-                ply++;
-                continue;
-            }
-            
-            auto result_search = Search::search(pos, 10, timeMs);
-            totalDepth += result_search.depth;
-            totalMoves++;
+        for (size_t ply = game.moves.size() + 1; ply-- > 0;) {
+            results[ply] = Search::search(pos, MAX_PLY, timeMs);
+            nodes += results[ply].nodes;
             
-            if (result_search.bestMove == Move::none()) {
-                // Game over
-                if (pos.checkers()) {
-                    result = pos.side_to_move() == WHITE ? "0-1" : "1-0";
-                } else {
-                    result = "1/2-1/2";
-                }
-                break;
-            }
+            // The game ended in this position
+            if (!results[ply].bestMove && pos.checkers())
+                results[ply].score = -VALUE_MATE;
             
-            // Check for draw by fifty-move rule or repetition
-            if (pos.rule50_count() >= 100 || pos.is_draw(pos.game_ply())) {
-                result = "1/2-1/2";
-                break;
+            // A single legal move is returned unsearched, but the position
+            // it leads to has just been searched
+            if (results[ply].bestMove && !results[ply].depth && ply < game.moves.size()) {
+                Value score = -results[ply + 1].score;
+                results[ply].score = is_win(score) ? score - 1 : is_loss(score) ? score + 1 : score;
+                results[ply].depth = results[ply + 1].depth;
             }
             
-            if (ply % 2 == 0) {
-                pgn += std::to_string(ply / 2 + 1) + ". ";
-            }
-            pgn += move_to_uci(result_search.bestMove) + " ";
-            
-            pos.do_move(result_search.bestMove, states[ply], nullptr);
-            ply++;
+            if (ply > 0)
+                pos.undo_move(game.moves[ply - 1]);
         }
         
-        if (ply >= maxPly) {
-            result = "1/2-1/2";
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        
+        // Scores are for the side that played the move: the best one, and
+        // the one of the move played, a ply further from mate
+        for (size_t ply = 0; ply < game.moves.size(); ++ply) {
+            int gamePly = startPly + int(ply);
+            Value played = -results[ply + 1].score;
+            played = is_win(played) ? played - 1 : is_loss(played) ? played + 1 : played;
+            
+            std::cout << gamePly / 2 + 1 << (gamePly & 1 ? "... " : ". ")
+                      << move_to_uci(game.moves[ply])
+                      << " | Best move: " << move_to_uci(results[ply].bestMove)
+                      << " | Evaluation: " << score_to_string(results[ply].score)
+                      << " | Played: " << score_to_string(played)
+                      << " | Depth: " << results[ply].depth << std::endl;
         }
         
-        std::cout << "[Result \"" << result << "\"]" << std::endl;
-        std::cout << std::endl;
-        std::cout << pgn << result << std::endl;
-        std::cout << std::endl;
+        std::cout << "Nodes: " << nodes << " Time: " << elapsed << " ms" << std::endl;
+    }
+}
+
+// Schedule command: run timed analysis jobs, one per line of the file as
+// "<arrival ms> <time ms> <deadline ms> <FEN>", earliest deadline first,
+// and report their queueing delays and deadline misses
+void cmd_schedule(const std::string& path, bool shrink) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Error: cannot open " << path << std::endl;
+        return;
     }
     
-    if (totalMoves > 0) {
-        std::cout << "Average depth: " << (double)totalDepth / totalMoves << std::endl;
+    std::vector<Scheduler::Job> jobs;
+    for (std::string line; std::getline(in, line);) {
+        std::istringstream is(line);
+        Scheduler::Job job;
+        if (is >> job.arrivalMs >> job.timeMs >> job.deadlineMs && std::getline(is >> std::ws, job.fen))
+            jobs.push_back(job);
+        else if (!line.empty())
+            std::cerr << "Warning: skipping job line: " << line << std::endl;
+    }
+    
+    auto reports = Scheduler::run(jobs, shrink);
+    
+    int missed = 0, maxQueue = 0, maxLatency = 0;
+    int64_t totalQueue = 0, totalLatency = 0;
+    
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const auto& r = reports[i];
+        std::cout << jobs[i].fen << " | Best move: " << move_to_uci(r.result.bestMove)
+                  << " | Evaluation: " << score_to_string(r.result.score)
+                  << " | Depth: " << r.result.depth << " | Queue: " << r.queueMs
+                  << " ms | Budget: " << r.budgetMs << " ms | Latency: " << r.latencyMs << " ms"
+                  << (r.missed ? " | Missed deadline" : "") << std::endl;
+        
+        missed += r.missed;
+        totalQueue += r.queueMs;
+        totalLatency += r.latencyMs;
+        maxQueue = std::max(maxQueue, r.queueMs);
+        maxLatency = std::max(maxLatency, r.latencyMs);
+    }
+    
+    if (!jobs.empty())
+        std::cout << "Jobs: " << jobs.size() << " Missed: " << missed
+                  << " Queue: avg " << totalQueue / int64_t(jobs.size()) << " ms, max " << maxQueue
+                  << " ms Latency: avg " << totalLatency / int64_t(jobs.size()) << " ms, max "
+                  << maxLatency << " ms" << std::endl;
+}
+
+// Extract command: write the positions of the games of a PGN file to
+// standard output, as FENs or packed records, with the counts on stderr
+void cmd_extract(const std::string& path, PGN::ExtractFormat format, const PGN::ExtractFilter& filter) {
+    auto start = std::chrono::steady_clock::now();
+    PGN::ExtractStats stats;
+    
+    if (!PGN::extract(path, filter, format, std::cout, stats)) {
+        std::cerr << "Error: cannot read " << path << " or write the positions" << std::endl;
+        return;
     }
+    std::cout.flush();
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    
+    std::cerr << "Games: " << stats.games << " Skipped: " << stats.skipped
+              << " Errors: " << stats.errors << " Positions: " << stats.positions
+              << " Time: " << elapsed << " ms" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
     // Initialize bitboards and position
     Bitboards::init();
+    Bitbases::init();
     Position::init();
+    Eval::init();
+    
+    // Options come before the command, e.g. "--threads 4 --hash 256"
+    int argi = 1;
+    while (argi + 1 < argc && std::string(argv[argi]).rfind("--", 0) == 0
+           && Search::set_option(argv[argi] + 2, argv[argi + 1]))
+        argi += 2;
+    
+    argc -= argi - 1;
+    argv += argi - 1;
     
     if (argc < 2) {
         std::cerr << "Usage:" << std::endl;
-        std::cerr << "  engine --analyze <FEN>" << std::endl;
-        std::cerr << "  engine --play <Game Count> <Max ply> <White Movetime(ms)> <Black Movetime(ms)>" << std::endl;
+        std::cerr << "  engine [options] --analyze <FEN>" << std::endl;
+        std::cerr << "  engine [options] --play <Game Count> <Max ply> <White Movetime(ms)> <Black Movetime(ms)>" << std::endl;
+        std::cerr << "  engine [options] --perft <Depth> <FEN>" << std::endl;
+        std::cerr << "  engine [options] --batch <FEN file> <Movetime(ms)>" << std::endl;
+        std::cerr << "  engine [options] --mate <Moves> <FEN>" << std::endl;
+        std::cerr << "  engine [options] --mcts <Time(ms)> <FEN>" << std::endl;
+        std::cerr << "  engine [options] --review <PGN file> <Movetime(ms)>" << std::endl;
+        std::cerr << "  engine [options] --schedule <Jobs file> [shrink|fixed]" << std::endl;
+        std::cerr << "  engine [options] --extract <PGN file> <fen|packed> [min-ply <n>] [max-ply <n>] [min-elo <n>] [no-check]" << std::endl;
+        std::cerr << "  engine [options] --worker <Address>" << std::endl;
+        std::cerr << "  engine [options] --coordinate <Address[,Address...]> <Time(ms)> <FEN>" << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --threads <n>  --hash <MB>  --numa <on|off>  --numa-history <on|off>  --smp <lazy|abdada>  --driver <full|mtdf>  --mcts-leaf-depth <n>  --tt-shm <name>  --checkpoint <file>  --checkpoint-interval <s>  --resume <file>  --cache <MB>  --cache-file <file>" << std::endl;
+        std::cerr << "  --syzygy-path <dir[:dir...]>  --syzygy-probe-depth <n>  --syzygy-probe-limit <n>  --syzygy-50-move-rule <on|off>" << std::endl;
         return 1;
     }
     
+    Search::init();
+    
     std::string command = argv[1];
     
     if (command == "--analyze") {
@@ -221,6 +603,123 @@ int main(int argc, char* argv[]) {
         
         cmd_play(gameCount, maxPly, whiteTimeMs, blackTimeMs);
     }
+    else if (command == "--perft") {
+        if (argc < 4) {
+            std::cerr << "Error: Required arguments: <Depth> <FEN>" << std::endl;
+            return 1;
+        }
+        
+        std::string fen;
+        for (int i = 3; i < argc; ++i) {
+            if (i > 3) fen += " ";
+            fen += argv[i];
+        }
+        
+        cmd_perft(std::stoi(argv[2]), fen);
+    }
+    else if (command == "--batch") {
+        if (argc < 4) {
+            std::cerr << "Error: Required arguments: <FEN file> <Movetime>" << std::endl;
+            return 1;
+        }
+        
+        cmd_batch(argv[2], std::stoi(argv[3]));
+    }
+    else if (command == "--review") {
+        if (argc < 4) {
+            std::cerr << "Error: Required arguments: <PGN file> <Movetime>" << std::endl;
+            return 1;
+        }
+        
+        cmd_review(argv[2], std::stoi(argv[3]));
+    }
+    else if (command == "--schedule") {
+        if (argc < 3 || (argc > 3 && std::string(argv[3]) != "shrink" && std::string(argv[3]) != "fixed")) {
+            std::cerr << "Error: Required arguments: <Jobs file> [shrink|fixed]" << std::endl;
+            return 1;
+        }
+        
+        cmd_schedule(argv[2], argc < 4 || std::string(argv[3]) == "shrink");
+    }
+    else if (command == "--extract") {
+        std::string format = argc > 3 ? argv[3] : "";
+        if (format != "fen" && format != "packed") {
+            std::cerr << "Error: Required arguments: <PGN file> <fen|packed>" << std::endl;
+            return 1;
+        }
+        
+        PGN::ExtractFilter filter;
+        for (int i = 4; i < argc; ++i) {
+            std::string name = argv[i];
+            if (name == "no-check")
+                filter.noCheck = true;
+            else if (i + 1 < argc && name == "min-ply")
+                filter.minPly = std::stoi(argv[++i]);
+            else if (i + 1 < argc && name == "max-ply")
+                filter.maxPly = std::stoi(argv[++i]);
+            else if (i + 1 < argc && name == "min-elo")
+                filter.minElo = std::stoi(argv[++i]);
+            else {
+                std::cerr << "Error: unknown filter " << name << std::endl;
+                return 1;
+            }
+        }
+        
+        cmd_extract(argv[2], format == "fen" ? PGN::FEN_LINES : PGN::PACKED, filter);
+    }
+    else if (command == "--mate") {
+        if (argc < 4 || std::stoi(argv[2]) < 1) {
+            std::cerr << "Error: Required arguments: <Moves> <FEN>" << std::endl;
+            return 1;
+        }
+        
+        std::string fen;
+        for (int i = 3; i < argc; ++i) {
+            if (i > 3) fen += " ";
+            fen += argv[i];
+        }
+        
+        cmd_mate(std::stoi(argv[2]), fen);
+    }
+    else if (command == "--mcts") {
+        if (argc < 4) {
+            std::cerr << "Error: Required arguments: <Time(ms)> <FEN>" << std::endl;
+            return 1;
+        }
+        
+        std::string fen;
+        for (int i = 3; i < argc; ++i) {
+            if (i > 3) fen += " ";
+            fen += argv[i];
+        }
+        
+        cmd_mcts(std::stoi(argv[2]), fen);
+    }
+    else if (command == "--worker") {
+        if (argc < 3) {
+            std::cerr << "Error: Required arguments: <Address>" << std::endl;
+            return 1;
+        }
+        
+        if (!Cluster::serve(argv[2])) {
+            std::cerr << "Error: cannot listen on " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    else if (command == "--coordinate") {
+        if (argc < 5) {
+            std::cerr << "Error: Required arguments: <Address[,Address...]> <Time(ms)> <FEN>" << std::endl;
+            return 1;
+        }
+        
+        std::string fen;
+        for (int i = 4; i < argc; ++i) {
+            if (i > 4) fen += " ";
+            fen += argv[i];
+        }
+        
+        cmd_coordinate(argv[2], std::stoi(argv[3]), fen);
+    }
     else {
         std::cerr << "Unknown command: " << command << std::endl;
         return 1;
@@ -0,0 +1,214 @@
+#include "mate.h"
+
+#include <algorithm>
+
+#include "movegen.h"
+#include "position.h"
+
+namespace Stockfish::Mate {
+
+namespace {
+    // Proof and disproof numbers are kept from the point of view of the side
+    // to move: phi is the proof number of its goal and delta the disproof
+    // number. The attacker's goal is to mate, the defender's to escape.
+    // A node with phi == 0 is won for the side to move, one with delta == 0
+    // is lost. Sums saturate at INFINITE.
+    constexpr uint32_t INFINITE = 1u << 30;
+
+    struct Entry {
+        Key      key;
+        uint32_t phi;
+        uint32_t delta;
+    };
+
+    class Solver {
+    public:
+        explicit Solver(size_t hashMB);
+
+        // Whether the attacker wins within plies from pos: with plies odd
+        // the attacker is to move, with plies even the defender
+        bool proven(Position& pos, int plies);
+
+        // Length in plies of the mate from pos against the best defence,
+        // at most maxPlies and of its parity, or -1 if there is none
+        int shortest(Position& pos, int maxPlies);
+
+        uint64_t nodes = 0;
+
+    private:
+        void mid(Position& pos, int plies, int ply, uint32_t thPhi, uint32_t thDelta);
+
+        // Entries of one position searched with different remaining plies
+        // are different entries
+        Key entry_key(Key posKey, int plies) const {
+            return posKey ^ (uint64_t(plies) * 0x9E3779B97F4A7C15ULL);
+        }
+        Entry& entry(Key key) { return table[key & (table.size() - 1)]; }
+        void lookup(Key key, uint32_t& phi, uint32_t& delta);
+        void store(Key key, uint32_t phi, uint32_t delta) { entry(key) = {key, phi, delta}; }
+
+        std::vector<Entry> table;
+    };
+}
+
+Solver::Solver(size_t hashMB) {
+    // Largest power of two number of entries that fits
+    size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= std::max<size_t>(hashMB, 1) * 1024 * 1024)
+        count *= 2;
+    table.assign(count, Entry{0, 0, 0});
+}
+
+// Unknown positions start with the proof and disproof numbers of one leaf
+void Solver::lookup(Key key, uint32_t& phi, uint32_t& delta) {
+    const Entry& e = entry(key);
+    if (e.key == key && (e.phi || e.delta)) {
+        phi = e.phi;
+        delta = e.delta;
+    } else
+        phi = delta = 1;
+}
+
+// Multiple iterative deepening: expand the most proving child of pos until
+// its proof or disproof number reaches the threshold given by the parent
+void Solver::mid(Position& pos, int plies, int ply, uint32_t thPhi, uint32_t thDelta) {
+    nodes++;
+
+    bool attacker = plies & 1;
+    Key key = entry_key(pos.key(), plies);
+    MoveList<LEGAL> moves(pos);
+
+    // Leaves: the side to move is mated, or the attacker has run out of
+    // plies, or the game is drawn
+    if (moves.size() == 0) {
+        bool mated = pos.checkers();
+        store(key, mated || attacker ? INFINITE : 0, mated || attacker ? 0 : INFINITE);
+        return;
+    }
+    if (plies == 0 || pos.is_draw(ply) || pos.rule50_count() >= 100) {
+        store(key, attacker ? INFINITE : 0, attacker ? 0 : INFINITE);
+        return;
+    }
+
+    // A child repeating a position of the current line is drawn on this
+    // path only, so it is scored here rather than stored under its key,
+    // where another path to it would find it drawn as well. Being final,
+    // it is never the child expanded.
+    Key  childKeys[MAX_MOVES];
+    bool repeated[MAX_MOVES];
+    for (size_t i = 0; i < moves.size(); ++i) {
+        StateInfo st;
+        pos.do_move(moves.begin()[i], st, nullptr);
+        childKeys[i] = entry_key(pos.key(), plies - 1);
+        repeated[i] = pos.is_repetition(ply + 1);
+        pos.undo_move(moves.begin()[i]);
+    }
+
+    while (true) {
+        // The goal of the side to move is reached by one child reaching it,
+        // and missed when every child's opposite goal is reached
+        uint32_t phi = INFINITE, delta = 0, delta2 = INFINITE, bestPhi = 0;
+        size_t best = 0;
+
+        for (size_t i = 0; i < moves.size(); ++i) {
+            uint32_t cPhi, cDelta;
+            if (repeated[i]) {
+                cPhi = attacker ? 0 : INFINITE;
+                cDelta = attacker ? INFINITE : 0;
+            } else
+                lookup(childKeys[i], cPhi, cDelta);
+
+            delta = std::min(delta + cPhi, INFINITE);
+            if (cDelta < phi) {
+                delta2 = phi;
+                phi = cDelta;
+                best = i;
+                bestPhi = cPhi;
+            } else if (cDelta < delta2)
+                delta2 = cDelta;
+        }
+
+        store(key, phi, delta);
+        if (phi >= thPhi || delta >= thDelta)
+            return;
+
+        uint64_t childThPhi = uint64_t(thDelta) + bestPhi - delta;
+        uint32_t childThDelta = std::min(thPhi, delta2 + 1);
+
+        Move m = moves.begin()[best];
+        StateInfo st;
+        pos.do_move(m, st, nullptr);
+        mid(pos, plies - 1, ply + 1, uint32_t(std::min<uint64_t>(childThPhi, INFINITE)),
+            childThDelta);
+        pos.undo_move(m);
+    }
+}
+
+bool Solver::proven(Position& pos, int plies) {
+    Key key = entry_key(pos.key(), plies);
+    uint32_t phi, delta;
+    lookup(key, phi, delta);
+
+    if (phi && delta) {
+        mid(pos, plies, 0, INFINITE, INFINITE);
+        lookup(key, phi, delta);
+    }
+
+    return (plies & 1) ? phi == 0 : delta == 0;
+}
+
+int Solver::shortest(Position& pos, int maxPlies) {
+    for (int plies = maxPlies & 1; plies <= maxPlies; plies += 2)
+        if (proven(pos, plies))
+            return plies;
+    return -1;
+}
+
+MateResult search(Position& pos, int maxMoves, size_t hashMB) {
+    MateResult result{false, 0, {}, 0};
+    Solver solver(hashMB);
+
+    int plies = solver.shortest(pos, std::min(2 * maxMoves - 1, MAX_PLY - 1));
+
+    if (plies > 0) {
+        result.found = true;
+        result.moves = (plies + 1) / 2;
+
+        // Walk the proof: the attacker plays a move mating the fastest and
+        // the defender the reply delaying the mate the longest
+        StateInfo states[MAX_PLY];
+        for (int ply = 0; plies > 0; ++ply, --plies) {
+            Move bestMove = Move::none();
+            int bestPlies = 0;
+
+            for (Move m : MoveList<LEGAL>(pos)) {
+                StateInfo st;
+                pos.do_move(m, st, nullptr);
+                int childPlies = solver.shortest(pos, plies - 1);
+                pos.undo_move(m);
+
+                bool better = (plies & 1) ? childPlies >= 0 && (!bestMove || childPlies < bestPlies)
+                                          : !bestMove || childPlies > bestPlies;
+                if (better) {
+                    bestMove = m;
+                    bestPlies = childPlies;
+                }
+            }
+
+            if (!bestMove)
+                break;
+
+            result.line.push_back(bestMove);
+            pos.do_move(bestMove, states[ply], nullptr);
+            plies = bestPlies + 1;
+        }
+
+        for (auto it = result.line.rbegin(); it != result.line.rend(); ++it)
+            pos.undo_move(*it);
+    }
+
+    result.nodes = solver.nodes;
+    return result;
+}
+
+}  // namespace Stockfish::Mate
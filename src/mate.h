@@ -0,0 +1,36 @@
+#ifndef MATE_H_INCLUDED
+#define MATE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+
+namespace Mate {
+
+struct MateResult {
+    bool found;              // A mate was proven
+    int  moves;              // Length of the mate in moves of the side to move
+    std::vector<Move> line;  // Shortest mate against the longest defence
+    uint64_t nodes;
+};
+
+// Looks for a mate in at most maxMoves moves by the side to move with
+// depth-first proof-number search (df-pn), using a hash table of hashMB
+// megabytes of its own. Mate lengths are tried in increasing order, so a
+// mate found is the shortest one. When none is found every line of up to
+// maxMoves moves has been refuted rather than left unsearched. Lines that
+// repeat a position count as drawn, and a position reached by transposition
+// shares the result of the path first searched, so a mate that only exists
+// where no position repeats may still be missed.
+MateResult search(Position& pos, int maxMoves, size_t hashMB);
+
+}  // namespace Mate
+
+}  // namespace Stockfish
+
+#endif // MATE_H_INCLUDED
@@ -0,0 +1,267 @@
+#include "mcts.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include "movegen.h"
+#include "position.h"
+#include "search.h"
+#include "thread.h"
+
+namespace Stockfish::MCTS {
+
+namespace {
+    // PUCT exploration constant, and how much lower than their parent's the
+    // win rate of unvisited children is assumed to be (first play urgency)
+    constexpr double CPUCT         = 1.5;
+    constexpr double FPU_REDUCTION = 0.2;
+
+    // Results are summed in fixed point with this many units per win
+    constexpr int64_t VALUE_GRAIN = 1 << 16;
+
+    // Prior weights of the children of a node before normalisation: good
+    // captures first, then checks, then the other moves
+    constexpr float PRIOR_GOOD_CAPTURE = 4.0f;
+    constexpr float PRIOR_CHECK        = 2.0f;
+    constexpr float PRIOR_OTHER        = 1.0f;
+
+    enum NodeState : uint8_t {
+        LEAF,       // Not expanded yet
+        EXPANDING,  // Being expanded by one thread
+        EXPANDED,   // Children are set
+        TERMINAL    // Game over, terminalValue holds the result
+    };
+
+    // A node of the tree. Statistics are updated concurrently by all the
+    // threads, while the children are written once by the thread that
+    // expands the node and published by the release store of the state.
+    struct Node {
+        Move     move = Move::none();  // Move leading to the node
+        float    prior = 0.0f;
+        float    terminalValue = 0.0f;  // For the side to move
+        uint32_t firstChild = 0;
+        uint16_t childCount = 0;
+
+        std::atomic<uint8_t> state{LEAF};
+        std::atomic<int>     visits{0};
+        std::atomic<int>     virtualLoss{0};
+        std::atomic<int64_t> valueSum{0};  // Results for the side that played move
+    };
+
+    // Node arena: all the nodes are allocated up front and handed out in
+    // blocks of siblings by bumping an index, so the threads never touch
+    // the heap while searching. Node 0 is the root.
+    class Tree {
+    public:
+        explicit Tree(size_t mbSize) :
+            capacity(std::max<size_t>(mbSize * 1024 * 1024 / sizeof(Node), 1)),
+            nodes(std::make_unique<Node[]>(capacity)) {}
+
+        Node& operator[](uint32_t idx) { return nodes[idx]; }
+
+        // Reserves count consecutive nodes and returns the first, or 0 when
+        // the arena is full
+        uint32_t allocate(size_t count) {
+            size_t first = used.fetch_add(count, std::memory_order_relaxed);
+            return first + count <= capacity ? uint32_t(first) : 0;
+        }
+
+    private:
+        size_t                  capacity;
+        std::unique_ptr<Node[]> nodes;
+        std::atomic<size_t>     used{1};
+    };
+
+    // Win rate of a search score, on the Elo scale of 400 centipawns per
+    // factor of ten in the odds
+    double win_rate(Value v) {
+        if (is_win(v))
+            return 1.0;
+        if (is_loss(v))
+            return 0.0;
+        return 1.0 / (1.0 + std::pow(10.0, -v / 400.0));
+    }
+
+    // PUCT selection. Virtual losses count as lost playouts, which steers
+    // the other threads away from the lines already being searched.
+    uint32_t select_child(Tree& tree, Node& node) {
+        int    parentVisits = node.visits.load(std::memory_order_relaxed);
+        double sqrtParent = std::sqrt(double(std::max(
+          parentVisits + node.virtualLoss.load(std::memory_order_relaxed), 1)));
+        double fpu = (parentVisits ? 1.0 - double(node.valueSum.load(std::memory_order_relaxed))
+                                             / VALUE_GRAIN / parentVisits
+                                   : 0.5)
+                   - FPU_REDUCTION;
+
+        uint32_t best = node.firstChild;
+        double   bestScore = -1.0;
+
+        for (uint32_t idx = node.firstChild; idx < node.firstChild + node.childCount; ++idx) {
+            Node& child = tree[idx];
+            int   n = child.visits.load(std::memory_order_relaxed)
+                  + child.virtualLoss.load(std::memory_order_relaxed);
+            double q = n ? double(child.valueSum.load(std::memory_order_relaxed)) / VALUE_GRAIN / n
+                         : fpu;
+            double score = q + CPUCT * child.prior * sqrtParent / (1 + n);
+
+            if (score > bestScore) {
+                bestScore = score;
+                best = idx;
+            }
+        }
+
+        return best;
+    }
+
+    // Scores pos for the side to move with the leaf search, given the time
+    // left before the deadline. Returns false if the search was stopped, its
+    // score being meaningless then.
+    bool leaf_value(Position& pos, Search::FixedDepthSearch& leafSearch,
+                    std::chrono::steady_clock::time_point deadline, double& value) {
+        int timeMs = int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                           deadline - std::chrono::steady_clock::now()).count());
+        Value v = leafSearch.search(pos, Search::options.mctsLeafDepth, std::max(timeMs, 0));
+        if (leafSearch.stopped())
+            return false;
+
+        value = win_rate(v);
+        return true;
+    }
+
+    // Scores a leaf for the side to move and, unless the game is over
+    // there or the arena is full, creates its children. The caller has
+    // moved the node to the EXPANDING state. Returns false, the node going
+    // back to the LEAF state, if the leaf search ran past the deadline.
+    bool expand(Position& pos, Tree& tree, Node& node, int ply,
+                Search::FixedDepthSearch& leafSearch,
+                std::chrono::steady_clock::time_point deadline, double& value) {
+        MoveList<LEGAL> moves(pos);
+
+        if (moves.size() == 0 || (ply > 0 && (pos.is_draw(ply) || pos.rule50_count() >= 100))) {
+            node.terminalValue = moves.size() == 0 && pos.checkers() ? 0.0f : 0.5f;
+            node.state.store(TERMINAL, std::memory_order_release);
+            value = node.terminalValue;
+            return true;
+        }
+
+        if (!leaf_value(pos, leafSearch, deadline, value)) {
+            node.state.store(LEAF, std::memory_order_release);
+            return false;
+        }
+
+        uint32_t first = tree.allocate(moves.size());
+        if (!first) {
+            node.state.store(LEAF, std::memory_order_release);
+            return true;
+        }
+
+        float weightSum = 0.0f;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            Move m = moves.begin()[i];
+            float weight = pos.capture_stage(m) && pos.see_ge(m) ? PRIOR_GOOD_CAPTURE
+                         : pos.gives_check(m)                   ? PRIOR_CHECK
+                                                                : PRIOR_OTHER;
+            tree[first + i].move = m;
+            tree[first + i].prior = weight;
+            weightSum += weight;
+        }
+        for (size_t i = 0; i < moves.size(); ++i)
+            tree[first + i].prior /= weightSum;
+
+        node.firstChild = first;
+        node.childCount = uint16_t(moves.size());
+        node.state.store(EXPANDED, std::memory_order_release);
+        return true;
+    }
+
+    // One playout: descend to a leaf, score it and back the result up the
+    // path. Returns false when the leaf is being expanded by another thread
+    // or its search ran past the deadline, in which case the playout is
+    // undone.
+    bool playout(Position& pos, Tree& tree, Search::FixedDepthSearch& leafSearch,
+                 std::chrono::steady_clock::time_point deadline) {
+        uint32_t  path[MAX_PLY];
+        StateInfo states[MAX_PLY];
+        int       length = 1;
+
+        path[0] = 0;
+        tree[0].virtualLoss.fetch_add(1, std::memory_order_relaxed);
+
+        while (length < MAX_PLY && tree[path[length - 1]].state.load(std::memory_order_acquire) == EXPANDED) {
+            uint32_t idx = select_child(tree, tree[path[length - 1]]);
+            tree[idx].virtualLoss.fetch_add(1, std::memory_order_relaxed);
+            pos.do_move(tree[idx].move, states[length - 1], nullptr);
+            path[length++] = idx;
+        }
+
+        Node&   leaf = tree[path[length - 1]];
+        uint8_t state = LEAF;
+        double  value;  // For the side to move at the leaf
+        bool    done = true;
+
+        if (leaf.state.load(std::memory_order_acquire) == TERMINAL)
+            value = leaf.terminalValue;
+        else if (length == MAX_PLY)
+            done = leaf_value(pos, leafSearch, deadline, value);
+        else if (leaf.state.compare_exchange_strong(state, EXPANDING, std::memory_order_acquire))
+            done = expand(pos, tree, leaf, length - 1, leafSearch, deadline, value);
+        else
+            done = false;
+
+        for (int i = length - 1; i >= 0; --i) {
+            Node& node = tree[path[i]];
+            if (done) {
+                value = 1.0 - value;
+                node.valueSum.fetch_add(int64_t(value * VALUE_GRAIN), std::memory_order_relaxed);
+                node.visits.fetch_add(1, std::memory_order_relaxed);
+            }
+            node.virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+            if (i > 0)
+                pos.undo_move(node.move);
+        }
+
+        return done;
+    }
+}
+
+MCTSResult search(const Position& pos, int timeMs) {
+    MCTSResult result{{}, 0};
+    Tree tree(Search::options.hashMB);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeMs);
+    std::atomic<uint64_t> playouts{0};
+    std::string fen = pos.fen();
+
+    // Every thread of the pool plays out on its own copy of the position,
+    // with its own leaf search
+    Threads.run_on_all([&](int) {
+        StateInfo si;
+        Position threadPos;
+        threadPos.set(fen, pos.is_chess960(), &si);
+        Search::FixedDepthSearch leafSearch;
+
+        while (std::chrono::steady_clock::now() < deadline)
+            if (playout(threadPos, tree, leafSearch, deadline))
+                playouts.fetch_add(1, std::memory_order_relaxed);
+    });
+
+    Node& root = tree[0];
+    if (root.state.load(std::memory_order_acquire) == EXPANDED)
+        for (uint32_t idx = root.firstChild; idx < root.firstChild + root.childCount; ++idx) {
+            int visits = tree[idx].visits;
+            result.moves.push_back({tree[idx].move, visits,
+                                    visits ? double(tree[idx].valueSum) / VALUE_GRAIN / visits : 0.0});
+        }
+
+    std::stable_sort(result.moves.begin(), result.moves.end(),
+                     [](const MoveStats& a, const MoveStats& b) { return a.visits > b.visits; });
+
+    result.playouts = playouts;
+    return result;
+}
+
+}  // namespace Stockfish::MCTS
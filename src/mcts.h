@@ -0,0 +1,38 @@
+#ifndef MCTS_H_INCLUDED
+#define MCTS_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+
+namespace MCTS {
+
+struct MoveStats {
+    Move   move;
+    int    visits;
+    double winRate;  // Expected score for the side to move, from 0 to 1
+};
+
+struct MCTSResult {
+    std::vector<MoveStats> moves;  // Root moves, most visited first
+    uint64_t playouts;
+};
+
+// Monte Carlo tree search from pos for timeMs milliseconds on every thread
+// of the pool. Leaves are scored by a fixed depth alpha-beta search of
+// options.mctsLeafDepth plies (0 for a quiescence search) turned into a win
+// rate, a leaf search still running at the end of the time being dropped
+// with its playout. The tree lives in a node arena of options.hashMB
+// megabytes; once it is full, leaves are still evaluated but no longer
+// expanded.
+MCTSResult search(const Position& pos, int timeMs);
+
+}  // namespace MCTS
+
+}  // namespace Stockfish
+
+#endif // MCTS_H_INCLUDED
@@ -152,12 +152,36 @@ Move* generate_pawn_moves(const Position& pos, Move* moveList, Bitboard target)
             b2 &= target;
         }
 
+        if constexpr (Type == QUIET_CHECKS)
+        {
+            // To make a quiet check, you either make a direct check by pushing a pawn
+            // or push a blocker pawn that is not on the same file as the enemy king.
+            // Discovered check promotions are already generated amongst the captures.
+            Square   ksq              = pos.square<KING>(Them);
+            Bitboard dcCandidatePawns = pos.blockers_for_king(Them) & ~file_bb(ksq);
+            b1 &= pos.check_squares(PAWN) | shift<Up>(dcCandidatePawns);
+            b2 &= pos.check_squares(PAWN) | shift<Up + Up>(dcCandidatePawns);
+        }
+
         moveList = splat_pawn_moves<Up>(moveList, b1);
         moveList = splat_pawn_moves<Up + Up>(moveList, b2);
     }
 
+    // Knight promotion is the only promotion that can give a direct check
+    // that's not already included in the queen promotion.
+    if constexpr (Type == QUIET_CHECKS)
+    {
+        Bitboard b = shift<Up>(pawnsOn7) & emptySquares & pos.check_squares(KNIGHT);
+
+        while (b)
+        {
+            Square to   = pop_lsb(b);
+            *moveList++ = Move::make<PROMOTION>(to - Up, to, KNIGHT);
+        }
+    }
+
     // Promotions and underpromotions
-    if (pawnsOn7)
+    else if (pawnsOn7)
     {
         Bitboard b1 = shift<UpRight>(pawnsOn7) & enemies;
         Bitboard b2 = shift<UpLeft>(pawnsOn7) & enemies;
@@ -206,7 +230,7 @@ Move* generate_pawn_moves(const Position& pos, Move* moveList, Bitboard target)
 }
 
 
-template<Color Us, PieceType Pt>
+template<Color Us, PieceType Pt, bool Checks>
 Move* generate_moves(const Position& pos, Move* moveList, Bitboard target) {
 
     static_assert(Pt != KING && Pt != PAWN, "Unsupported piece type in generate_moves()");
@@ -218,6 +242,10 @@ Move* generate_moves(const Position& pos, Move* moveList, Bitboard target) {
         Square   from = pop_lsb(bb);
         Bitboard b    = attacks_bb<Pt>(from, pos.pieces()) & target;
 
+        // To check, you either move freely a blocker or make a direct check
+        if (Checks && (Pt == QUEEN || !(pos.blockers_for_king(~Us) & from)))
+            b &= pos.check_squares(Pt);
+
         moveList = splat_moves(moveList, from, b);
     }
 
@@ -230,8 +258,9 @@ Move* generate_all(const Position& pos, Move* moveList) {
 
     static_assert(Type != LEGAL, "Unsupported type in generate_all()");
 
-    const Square ksq = pos.square<KING>(Us);
-    Bitboard     target;
+    constexpr bool Checks = Type == QUIET_CHECKS;  // Reduce template instantiations
+    const Square   ksq    = pos.square<KING>(Us);
+    Bitboard       target;
 
     // Skip generating non-king moves when in double check
     if (Type != EVASIONS || !more_than_one(pos.checkers()))
@@ -239,23 +268,30 @@ Move* generate_all(const Position& pos, Move* moveList) {
         target = Type == EVASIONS     ? between_bb(ksq, lsb(pos.checkers()))
                : Type == NON_EVASIONS ? ~pos.pieces(Us)
                : Type == CAPTURES     ? pos.pieces(~Us)
-                                      : ~pos.pieces();  // QUIETS
+                                      : ~pos.pieces();  // QUIETS and QUIET_CHECKS
 
         moveList = generate_pawn_moves<Us, Type>(pos, moveList, target);
-        moveList = generate_moves<Us, KNIGHT>(pos, moveList, target);
-        moveList = generate_moves<Us, BISHOP>(pos, moveList, target);
-        moveList = generate_moves<Us, ROOK>(pos, moveList, target);
-        moveList = generate_moves<Us, QUEEN>(pos, moveList, target);
+        moveList = generate_moves<Us, KNIGHT, Checks>(pos, moveList, target);
+        moveList = generate_moves<Us, BISHOP, Checks>(pos, moveList, target);
+        moveList = generate_moves<Us, ROOK, Checks>(pos, moveList, target);
+        moveList = generate_moves<Us, QUEEN, Checks>(pos, moveList, target);
     }
 
-    Bitboard b = attacks_bb<KING>(ksq) & (Type == EVASIONS ? ~pos.pieces(Us) : target);
+    // A king move can only give a discovered check
+    if (!Checks || (pos.blockers_for_king(~Us) & ksq))
+    {
+        Bitboard b = attacks_bb<KING>(ksq) & (Type == EVASIONS ? ~pos.pieces(Us) : target);
+
+        if (Checks)
+            b &= ~attacks_bb<QUEEN>(pos.square<KING>(~Us));
 
-    moveList = splat_moves(moveList, ksq, b);
+        moveList = splat_moves(moveList, ksq, b);
 
-    if ((Type == QUIETS || Type == NON_EVASIONS) && pos.can_castle(Us & ANY_CASTLING))
-        for (CastlingRights cr : {Us & KING_SIDE, Us & QUEEN_SIDE})
-            if (!pos.castling_impeded(cr) && pos.can_castle(cr))
-                *moveList++ = Move::make<CASTLING>(ksq, pos.castling_rook_square(cr));
+        if ((Type == QUIETS || Type == NON_EVASIONS) && pos.can_castle(Us & ANY_CASTLING))
+            for (CastlingRights cr : {Us & KING_SIDE, Us & QUEEN_SIDE})
+                if (!pos.castling_impeded(cr) && pos.can_castle(cr))
+                    *moveList++ = Move::make<CASTLING>(ksq, pos.castling_rook_square(cr));
+    }
 
     return moveList;
 }
@@ -265,6 +301,8 @@ Move* generate_all(const Position& pos, Move* moveList) {
 
 // <CAPTURES>     Generates all pseudo-legal captures plus queen promotions
 // <QUIETS>       Generates all pseudo-legal non-captures and underpromotions
+// <QUIET_CHECKS> Generates all pseudo-legal non-captures giving check,
+//                except castling
 // <EVASIONS>     Generates all pseudo-legal check evasions
 // <NON_EVASIONS> Generates all pseudo-legal captures and non-captures
 //
@@ -284,6 +322,7 @@ Move* generate(const Position& pos, Move* moveList) {
 // Explicit template instantiations
 template Move* generate<CAPTURES>(const Position&, Move*);
 template Move* generate<QUIETS>(const Position&, Move*);
+template Move* generate<QUIET_CHECKS>(const Position&, Move*);
 template Move* generate<EVASIONS>(const Position&, Move*);
 template Move* generate<NON_EVASIONS>(const Position&, Move*);
 
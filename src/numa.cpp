@@ -0,0 +1,99 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+    #include <sched.h>
+#endif
+
+namespace Stockfish::Numa {
+
+namespace {
+
+// Parses a kernel cpulist such as "0-3,8-11"
+std::vector<int> parse_cpulist(const std::string& list) {
+    std::vector<int>  cpus;
+    std::stringstream ss(list);
+    std::string       range;
+
+    while (std::getline(ss, range, ','))
+    {
+        if (range.empty() || range == "\n")
+            continue;
+
+        size_t dash  = range.find('-');
+        int    first = std::stoi(range.substr(0, dash));
+        int    last  = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+        for (int c = first; c <= last; ++c)
+            cpus.push_back(c);
+    }
+    return cpus;
+}
+
+std::vector<std::vector<int>> read_topology() {
+    std::vector<std::vector<int>> result;
+
+    for (int n = 0;; ++n)
+    {
+        std::ifstream f("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+        if (!f)
+            break;
+
+        std::string list;
+        std::getline(f, list);
+        std::vector<int> cpus = parse_cpulist(list);
+
+        // Memory-only nodes have no CPUs to run search threads on
+        if (!cpus.empty())
+            result.push_back(cpus);
+    }
+
+    if (result.empty())
+    {
+        std::vector<int> all;
+        for (int c = 0; c < int(std::max(1u, std::thread::hardware_concurrency())); ++c)
+            all.push_back(c);
+        result.push_back(all);
+    }
+
+    return result;
+}
+
+}  // namespace
+
+const std::vector<std::vector<int>>& nodes() {
+    static const std::vector<std::vector<int>> topology = read_topology();
+    return topology;
+}
+
+int node_for_thread(int idx, int threadCount) {
+    int nodeCount = int(nodes().size());
+    int perNode   = (std::max(threadCount, 1) + nodeCount - 1) / nodeCount;
+    return std::min(idx / perNode, nodeCount - 1);
+}
+
+bool bind_this_thread(int idx, int threadCount) {
+#if defined(__linux__)
+    int                     node    = node_for_thread(idx, threadCount);
+    const std::vector<int>& cpus    = nodes()[node];
+    int                     perNode = (std::max(threadCount, 1) + int(nodes().size()) - 1)
+                                      / int(nodes().size());
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[(idx - node * perNode) % cpus.size()], &set);
+
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void) idx;
+    (void) threadCount;
+    return false;
+#endif
+}
+
+}  // namespace Stockfish::Numa
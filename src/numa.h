@@ -0,0 +1,22 @@
+#ifndef NUMA_H_INCLUDED
+#define NUMA_H_INCLUDED
+
+#include <vector>
+
+namespace Stockfish::Numa {
+
+// CPUs of each NUMA node as listed in /sys/devices/system/node. When the
+// topology is not available a single node holding all CPUs is reported.
+const std::vector<std::vector<int>>& nodes();
+
+// Node the idx-th of threadCount threads belongs to. Threads are grouped in
+// contiguous blocks so that neighbouring indices share a node.
+int node_for_thread(int idx, int threadCount);
+
+// Pins the calling thread to one core of its node. Returns false if pinning
+// is not supported on this platform or the call failed.
+bool bind_this_thread(int idx, int threadCount);
+
+}  // namespace Stockfish::Numa
+
+#endif // NUMA_H_INCLUDED
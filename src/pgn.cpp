@@ -0,0 +1,422 @@
+#include "pgn.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "movegen.h"
+#include "position.h"
+#include "thread.h"
+
+namespace Stockfish::PGN {
+
+namespace {
+    constexpr const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    bool is_file(char c) { return c >= 'a' && c <= 'h'; }
+    bool is_rank(char c) { return c >= '1' && c <= '8'; }
+
+    Square to_square(char file, char rank) { return make_square(File(file - 'a'), Rank(rank - '1')); }
+
+    // Piece type of an uppercase SAN letter, NO_PIECE_TYPE for other chars
+    PieceType piece_type(char c) {
+        const char* p = c ? std::strchr(" PNBRQK", c) : nullptr;
+        return p ? PieceType(p - " PNBRQK") : NO_PIECE_TYPE;
+    }
+
+    // Parses a [Name "Value"] tag line, unescaping the value
+    void read_tag(std::string_view line, Game& game) {
+        size_t nameEnd = line.find_first_of(" \t\"", 1);
+        size_t open = line.find('"');
+        if (nameEnd == std::string_view::npos || open == std::string_view::npos)
+            return;
+
+        std::string value;
+        for (size_t i = open + 1; i < line.size() && line[i] != '"'; ++i) {
+            if (line[i] == '\\' && i + 1 < line.size())
+                ++i;
+            value += line[i];
+        }
+
+        game.tags.emplace_back(std::string(line.substr(1, nameEnd - 1)), value);
+    }
+
+    // Extraction works on chunks of about CHUNK_SIZE bytes, CHUNKS_PER_THREAD
+    // per pool thread at a time
+    constexpr size_t CHUNK_SIZE        = 1 << 20;
+    constexpr int    CHUNKS_PER_THREAD = 4;
+
+    // Offset of the first game starting on a line after offset: a tag line
+    // whose previous non blank line is movetext. The size of text if none.
+    size_t game_start(std::string_view text, size_t offset) {
+        for (size_t nl = text.find('\n', offset); nl != std::string_view::npos;
+             nl = text.find('\n', nl + 1)) {
+            if (nl + 1 >= text.size() || text[nl + 1] != '[')
+                continue;
+
+            size_t prevEnd = text.find_last_not_of(" \t\r\n", nl);
+            if (prevEnd == std::string_view::npos)
+                continue;
+            size_t prevStart = text.rfind('\n', prevEnd);
+            prevStart = prevStart == std::string_view::npos ? 0 : prevStart + 1;
+
+            if (text[prevStart] != '[')
+                return nl + 1;
+        }
+        return text.size();
+    }
+
+    // Appends the positions of the games of one chunk to out
+    void extract_chunk(std::string_view text, const ExtractFilter& filter, ExtractFormat format,
+                       std::string& out, ExtractStats& stats) {
+        Game game;
+        std::deque<StateInfo> states;
+
+        while (next_game(text, game)) {
+            stats.games++;
+
+            if (filter.minElo > 0
+                && (std::atoi(game.tag("WhiteElo").c_str()) < filter.minElo
+                    || std::atoi(game.tag("BlackElo").c_str()) < filter.minElo)) {
+                stats.skipped++;
+                continue;
+            }
+
+            read_moves(game);
+            if (!game.complete)
+                stats.errors++;
+
+            Position pos;
+            states.assign(1, StateInfo());
+            try {
+                pos.set(game.fen, false, &states.back());
+            } catch (const std::exception&) {
+                continue;
+            }
+
+            for (int ply = 0; ply <= filter.maxPly; ++ply) {
+                if (ply >= filter.minPly && !(filter.noCheck && pos.checkers())) {
+                    if (format == FEN_LINES) {
+                        out += pos.fen();
+                        out += '\n';
+                    } else {
+                        PackedPosition packed = pack(pos);
+                        out.append(reinterpret_cast<const char*>(&packed), sizeof(packed));
+                    }
+                    stats.positions++;
+                }
+
+                if (ply == int(game.moves.size()))
+                    break;
+                pos.do_move(game.moves[ply], states.emplace_back(), nullptr);
+            }
+        }
+    }
+
+    bool is_result(std::string_view token) {
+        return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+    }
+}
+
+std::string Game::tag(const std::string& name) const {
+    for (const auto& [tagName, value] : tags)
+        if (tagName == name)
+            return value;
+    return "";
+}
+
+bool next_game(std::string_view& text, Game& game) {
+    game.tags.clear();
+    game.movetext.clear();
+    game.moves.clear();
+    game.complete = true;
+
+    std::string& movetext = game.movetext;
+    bool inMovetext = false;
+
+    while (!text.empty()) {
+        size_t lineEnd = text.find('\n');
+        size_t next = lineEnd == std::string_view::npos ? text.size() : lineEnd + 1;
+        std::string_view line = text.substr(0, next);
+
+        size_t first = line.find_first_not_of(" \t\r\n");
+        if (first == std::string_view::npos) {
+            text.remove_prefix(next);
+            continue;
+        }
+        line.remove_prefix(first);
+
+        if (line[0] == '[') {
+            if (inMovetext)
+                break;
+            read_tag(line, game);
+        }
+        // Lines starting with '%' are escaped from PGN processing
+        else if (line[0] != '%') {
+            inMovetext = true;
+            movetext += line;
+            if (movetext.back() != '\n')
+                movetext += '\n';
+        }
+
+        text.remove_prefix(next);
+    }
+
+    if (game.tags.empty() && !inMovetext)
+        return false;
+
+    std::string fen = game.tag("FEN");
+    game.fen = fen.empty() ? START_FEN : fen;
+    return true;
+}
+
+void read_moves(Game& game) {
+    std::string_view movetext = game.movetext;
+    game.moves.clear();
+    game.complete = true;
+
+    Position pos;
+    std::deque<StateInfo> states(1);
+
+    try {
+        pos.set(game.fen, false, &states.back());
+    } catch (const std::exception&) {
+        game.complete = false;
+        return;
+    }
+
+    int variationDepth = 0;
+    size_t i = 0;
+
+    while (i < movetext.size()) {
+        char c = movetext[i];
+
+        if (c == '{')
+            i = std::min(movetext.find('}', i), movetext.size()) + 1;
+        else if (c == ';')
+            i = std::min(movetext.find('\n', i), movetext.size());
+        else if (c == '(' || c == ')') {
+            variationDepth += c == '(' ? 1 : -1;
+            ++i;
+        } else if (std::strchr(" \t\r\n", c))
+            ++i;
+        else {
+            size_t end = std::min(movetext.find_first_of(" \t\r\n{};()", i), movetext.size());
+            std::string_view token = movetext.substr(i, end - i);
+            i = end;
+
+            // NAGs, and the moves of variations
+            if (token[0] == '$' || variationDepth > 0)
+                continue;
+
+            if (is_result(token))
+                return;
+
+            // Move numbers, possibly glued to the move: "12." "12..." "12.e4"
+            size_t digits = token.find_first_not_of("0123456789");
+            if (digits > 0 && digits != std::string_view::npos && token[digits] == '.') {
+                size_t moveStart = token.find_first_not_of('.', digits);
+                token.remove_prefix(moveStart == std::string_view::npos ? token.size() : moveStart);
+            }
+            if (token.empty())
+                continue;
+
+            Move m = parse_move(pos, token);
+            if (!m) {
+                game.complete = false;
+                return;
+            }
+
+            game.moves.push_back(m);
+            pos.do_move(m, states.emplace_back(), nullptr);
+        }
+    }
+}
+
+bool read_game(std::string_view& text, Game& game) {
+    if (!next_game(text, game))
+        return false;
+
+    read_moves(game);
+    return true;
+}
+
+Move parse_move(const Position& pos, std::string_view token) {
+    // Check marks and annotations
+    while (!token.empty() && std::strchr("+#!?", token.back()))
+        token.remove_suffix(1);
+    if (token.size() < 2)
+        return Move::none();
+
+    MoveList<LEGAL> moves(pos);
+
+    if (token == "O-O" || token == "0-0" || token == "O-O-O" || token == "0-0-0") {
+        bool kingSide = token.size() == 3;
+        for (Move m : moves)
+            if (m.type_of() == CASTLING && (m.to_sq() > m.from_sq()) == kingSide)
+                return m;
+        return Move::none();
+    }
+
+    // Coordinate notation
+    if ((token.size() == 4 || token.size() == 5) && is_file(token[0]) && is_rank(token[1])
+        && is_file(token[2]) && is_rank(token[3])) {
+        Square from = to_square(token[0], token[1]);
+        Square to = to_square(token[2], token[3]);
+        PieceType promotion = token.size() == 5 ? piece_type(char(std::toupper(token[4]))) : NO_PIECE_TYPE;
+
+        for (Move m : moves) {
+            Square kingTo = make_square(m.to_sq() > from ? FILE_G : FILE_C, rank_of(from));
+            if (m.from_sq() == from
+                && (m.to_sq() == to || (m.type_of() == CASTLING && kingTo == to))
+                && (m.type_of() == PROMOTION ? m.promotion_type() : NO_PIECE_TYPE) == promotion)
+                return m;
+        }
+        return Move::none();
+    }
+
+    // SAN: piece letter unless a pawn moves, disambiguation, destination
+    // and promotion piece, with or without '='
+    PieceType pt = piece_type(token[0]);
+    if (pt != NO_PIECE_TYPE)
+        token.remove_prefix(1);
+    else
+        pt = PAWN;
+
+    PieceType promotion = NO_PIECE_TYPE;
+    if (pt == PAWN && piece_type(token.back()) >= KNIGHT) {
+        promotion = piece_type(token.back());
+        token.remove_suffix(1);
+        if (!token.empty() && token.back() == '=')
+            token.remove_suffix(1);
+    }
+
+    if (token.size() < 2 || !is_file(token[token.size() - 2]) || !is_rank(token.back()))
+        return Move::none();
+    Square to = to_square(token[token.size() - 2], token.back());
+
+    int fromFile = -1, fromRank = -1;
+    for (char c : token.substr(0, token.size() - 2)) {
+        if (is_file(c))
+            fromFile = c - 'a';
+        else if (is_rank(c))
+            fromRank = c - '1';
+        else if (c != 'x' && c != ':')
+            return Move::none();
+    }
+
+    Move found = Move::none();
+    for (Move m : moves) {
+        if (m.type_of() == CASTLING || m.to_sq() != to || type_of(pos.moved_piece(m)) != pt
+            || (m.type_of() == PROMOTION ? m.promotion_type() : NO_PIECE_TYPE) != promotion
+            || (fromFile >= 0 && file_of(m.from_sq()) != fromFile)
+            || (fromRank >= 0 && rank_of(m.from_sq()) != fromRank))
+            continue;
+
+        // Ambiguous
+        if (found)
+            return Move::none();
+        found = m;
+    }
+
+    return found;
+}
+
+PackedPosition pack(const Position& pos) {
+    PackedPosition packed{};
+    packed.occupied = pos.pieces();
+
+    int i = 0;
+    for (Bitboard b = pos.pieces(); b; ++i)
+        packed.pieces[i / 2] |= uint8_t(pos.piece_on(pop_lsb(b)) << (4 * (i & 1)));
+
+    packed.sideToMove = uint8_t(pos.side_to_move());
+    for (CastlingRights cr : {WHITE_OO, WHITE_OOO, BLACK_OO, BLACK_OOO})
+        if (pos.can_castle(cr))
+            packed.castling |= cr;
+    packed.epSquare = uint8_t(pos.ep_square());
+    packed.rule50 = uint8_t(std::min(pos.rule50_count(), 255));
+    packed.fullMove = uint16_t(pos.game_ply() / 2 + 1);
+    return packed;
+}
+
+bool extract(const std::string& path, const ExtractFilter& filter, ExtractFormat format,
+             std::ostream& out, ExtractStats& stats) {
+    stats = {0, 0, 0, 0};
+
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st {};
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    size_t size = size_t(st.st_size);
+    void*  data = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    if (size)
+        madvise(data, size, MADV_SEQUENTIAL);
+
+    std::string_view text(static_cast<const char*>(data), size);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string_view text(contents);
+#endif
+
+    size_t roundSize = size_t(Threads.size()) * CHUNKS_PER_THREAD;
+    std::vector<std::string_view> chunks;
+    std::vector<std::string> outputs(roundSize);
+    std::vector<ExtractStats> chunkStats(roundSize);
+
+    for (size_t offset = 0; offset < text.size() && out;) {
+        chunks.clear();
+        while (chunks.size() < roundSize && offset < text.size()) {
+            size_t end = game_start(text, std::min(offset + CHUNK_SIZE, text.size()));
+            chunks.push_back(text.substr(offset, end - offset));
+            offset = end;
+        }
+
+        Threads.parallel_for(0, chunks.size(), [&](size_t i) {
+            outputs[i].clear();
+            chunkStats[i] = {0, 0, 0, 0};
+            extract_chunk(chunks[i], filter, format, outputs[i], chunkStats[i]);
+        });
+
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            out.write(outputs[i].data(), std::streamsize(outputs[i].size()));
+            stats.games += chunkStats[i].games;
+            stats.skipped += chunkStats[i].skipped;
+            stats.errors += chunkStats[i].errors;
+            stats.positions += chunkStats[i].positions;
+        }
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    if (size)
+        munmap(data, size);
+#endif
+
+    return bool(out);
+}
+
+}  // namespace Stockfish::PGN
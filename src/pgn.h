@@ -0,0 +1,104 @@
+#ifndef PGN_H_INCLUDED
+#define PGN_H_INCLUDED
+
+#include <climits>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+
+namespace PGN {
+
+struct Game {
+    std::vector<std::pair<std::string, std::string>> tags;  // In file order
+    std::string       fen;       // Start position, from the FEN tag or the standard one
+    std::string       movetext;  // As read, comments and variations included
+    std::vector<Move> moves;     // Moves played, replayed from fen
+    bool              complete;  // False if a move or the FEN could not be read
+
+    // Value of the tag, empty if the game has none of that name
+    std::string tag(const std::string& name) const;
+};
+
+// Reads the tags and the movetext of the game at the front of text and
+// advances text past it. A game is its tag lines followed by its movetext,
+// which ends where the next tag line starts. Returns false when text holds
+// no more games.
+bool next_game(std::string_view& text, Game& game);
+
+// Replays the movetext of game into its moves, up to the result or to the
+// first move that is not legal. Comments, variations, NAGs and move
+// numbers are skipped.
+void read_moves(Game& game);
+
+// next_game() followed by read_moves()
+bool read_game(std::string_view& text, Game& game);
+
+// Move of pos written in SAN, or in the coordinate notation of the
+// engine's own PGN output (castling as the king's destination or as the
+// king taking its rook). Returns Move::none() unless exactly one legal
+// move matches.
+Move parse_move(const Position& pos, std::string_view token);
+
+// Position extraction from PGN files, for building training or test sets
+enum ExtractFormat {
+    FEN_LINES,  // One FEN per line
+    PACKED      // PackedPosition records
+};
+
+// Positions to extract: the ones from ply minPly to maxPly of each game,
+// 0 being its start position, of games where both players are rated at
+// least minElo, leaving out positions in check if noCheck is set
+struct ExtractFilter {
+    int  minPly  = 0;
+    int  maxPly  = INT_MAX;
+    int  minElo  = 0;
+    bool noCheck = false;
+};
+
+// Fixed size binary position: the occupied squares, then the pieces on
+// them from a1 to h8 as 4 bit Piece values, low nibble first
+struct PackedPosition {
+    uint64_t occupied;
+    uint8_t  pieces[16];
+    uint8_t  sideToMove;
+    uint8_t  castling;  // CastlingRights
+    uint8_t  epSquare;  // SQ_NONE if none
+    uint8_t  rule50;
+    uint16_t fullMove;
+    uint16_t reserved;  // Zero
+};
+
+static_assert(sizeof(PackedPosition) == 32, "Packed positions take 32 bytes");
+
+PackedPosition pack(const Position& pos);
+
+struct ExtractStats {
+    uint64_t games;      // Games read
+    uint64_t skipped;    // Games left out by the rating filter
+    uint64_t errors;     // Games with a FEN or a move that could not be read
+    uint64_t positions;  // Positions written
+};
+
+// Writes the positions of the games in the PGN file at path to out. The
+// file is mapped into memory and split at game boundaries into chunks that
+// the thread pool parses in parallel, in rounds of a few chunks per thread
+// whose output is written in file order, so memory use does not grow with
+// the size of the file. The positions of a game that cannot be read fully
+// are written up to the move in error. Returns false if the file cannot
+// be read or out cannot be written.
+bool extract(const std::string& path, const ExtractFilter& filter, ExtractFormat format,
+             std::ostream& out, ExtractStats& stats);
+
+}  // namespace PGN
+
+}  // namespace Stockfish
+
+#endif // PGN_H_INCLUDED
@@ -0,0 +1,110 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <thread>
+
+#include "position.h"
+#include "thread.h"
+
+namespace Stockfish::Scheduler {
+
+namespace {
+    // Least search time granted to a job, even one already late: a shallow
+    // result is still better than none
+    constexpr int MIN_BUDGET_MS = 10;
+
+    // Time kept between the end of a search and its deadline, for starting
+    // and stopping the search
+    constexpr int DEADLINE_MARGIN_MS = 5;
+}
+
+std::vector<JobReport> run(const std::vector<Job>& jobs, bool shrink) {
+    std::vector<JobReport> reports(jobs.size());
+
+    // Jobs in order of arrival, and the ones arrived but not started,
+    // earliest deadline on top
+    std::vector<size_t> arrivals(jobs.size());
+    std::iota(arrivals.begin(), arrivals.end(), 0);
+    std::stable_sort(arrivals.begin(), arrivals.end(),
+                     [&](size_t a, size_t b) { return jobs[a].arrivalMs < jobs[b].arrivalMs; });
+    size_t nextArrival = 0;
+
+    auto later = [&](size_t a, size_t b) {
+        return jobs[a].arrivalMs + jobs[a].deadlineMs > jobs[b].arrivalMs + jobs[b].deadlineMs;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> waiting(later);
+    std::mutex mutex;
+
+    auto start = std::chrono::steady_clock::now();
+    auto now_ms = [start] {
+        return int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start).count());
+    };
+
+    // Every pool thread runs one search at a time, as in batch mode
+    int slots = Threads.size();
+
+    Threads.parallel_for(0, size_t(slots), [&](size_t) {
+        while (true) {
+            size_t idx;
+            int queueLength;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (nextArrival < arrivals.size() && jobs[arrivals[nextArrival]].arrivalMs <= now_ms())
+                    waiting.push(arrivals[nextArrival++]);
+
+                if (waiting.empty()) {
+                    if (nextArrival == arrivals.size())
+                        return;
+
+                    int wake = jobs[arrivals[nextArrival]].arrivalMs;
+                    lock.unlock();
+                    std::this_thread::sleep_until(start + std::chrono::milliseconds(wake));
+                    continue;
+                }
+
+                idx = waiting.top();
+                waiting.pop();
+                queueLength = int(waiting.size());
+            }
+
+            const Job& job = jobs[idx];
+            JobReport& report = reports[idx];
+            int startMs = now_ms();
+
+            report.budgetMs = job.timeMs;
+            if (shrink) {
+                int slack = job.arrivalMs + job.deadlineMs - startMs - DEADLINE_MARGIN_MS;
+                report.budgetMs = std::min(report.budgetMs, slack);
+                if (queueLength > slots)
+                    report.budgetMs = int(int64_t(report.budgetMs) * slots / queueLength);
+                report.budgetMs = std::max(report.budgetMs, MIN_BUDGET_MS);
+            }
+
+            report.result = {Move::none(), VALUE_ZERO, 0, 0, {}, 0};
+            StateInfo si;
+            Position pos;
+            try {
+                pos.set(job.fen, false, &si);
+                report.result = Search::search(pos, MAX_PLY, report.budgetMs);
+            } catch (const std::exception&) {}
+
+            // The result is ready when the search says so. Search::search()
+            // returns later if, waiting for its helpers, this thread ran
+            // pool tasks of other jobs meanwhile.
+            int endMs = startMs + report.result.elapsedMs;
+            report.queueMs = startMs - job.arrivalMs;
+            report.latencyMs = endMs - job.arrivalMs;
+            report.missed = report.latencyMs > job.deadlineMs;
+        }
+    });
+
+    return reports;
+}
+
+}  // namespace Stockfish::Scheduler
@@ -0,0 +1,41 @@
+#ifndef SCHEDULER_H_INCLUDED
+#define SCHEDULER_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include "search.h"
+
+namespace Stockfish {
+
+// Scheduling of many analysis requests, each with its own time limit and
+// deadline, over the thread pool
+namespace Scheduler {
+
+struct Job {
+    std::string fen;
+    int arrivalMs;   // When the job comes in, from the start of the run
+    int timeMs;      // Search time asked for
+    int deadlineMs;  // Time after its arrival by which the result is due
+};
+
+struct JobReport {
+    Search::SearchResult result;
+    int  queueMs;    // From arrival to the start of the search
+    int  budgetMs;   // Search time granted
+    int  latencyMs;  // From arrival to the result
+    bool missed;     // The result came after the deadline
+};
+
+// Runs the jobs as they arrive, one search per pool thread, a thread that
+// becomes free taking the waiting job with the earliest deadline (EDF).
+// With shrink, a job gets at most the time left before its deadline, and
+// once more jobs wait than there are threads, that time scaled down by the
+// threads over the jobs waiting, so that a burst does not push every later
+// job past its deadline. Reports are in the order of jobs.
+std::vector<JobReport> run(const std::vector<Job>& jobs, bool shrink);
+
+}  // namespace Scheduler
+
+}  // namespace Stockfish
+
+#endif // SCHEDULER_H_INCLUDED
@@ -1,49 +1,308 @@
 #include "search.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <climits>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <cstring>
+#include "cache.h"
 #include "evaluate.h"
 #include "movegen.h"
+#include "numa.h"
 #include "position.h"
+#include "tbprobe.h"
+#include "thread.h"
+#include "tt.h"
 #include "types.h"
 
-namespace Stockfish {
-    // Minimal TranspositionTable class for null move compatibility
-    class TranspositionTable {
-    public:
-        void prefetch([[maybe_unused]] Key key) const {}
-    };
-}
-
 namespace Stockfish::Search {
 
+Options options;
+
 namespace {
-    static Stockfish::TranspositionTable dummyTT;
-    uint64_t nodeCount;
-    std::chrono::steady_clock::time_point searchStart;
-    int searchTimeMs;
-    bool stopSearch;
-    
-    // Killer moves for move ordering
-    Move killerMoves[MAX_PLY][2];
-    
-    // History heuristic table
-    int history[COLOR_NB][SQUARE_NB][SQUARE_NB];
-    
-    // Simple transposition table
-    struct TTEntry {
-        Key key;
-        Move best_move;
-        Value value;
-        int depth;
-        uint8_t flag; // 0=exact, 1=lower, 2=upper
+    ResultCache resultCache;
+    
+    // Move ordering tables learned across the nodes of a search: the
+    // butterfly history of quiet moves, indexed by [color][from][to], and
+    // the quiet move that refuted the previous move, indexed by the [piece]
+    // and [to] square of that move. With int16 entries the whole block takes
+    // 18 KB and stays in L1/L2.
+    struct alignas(64) History {
+        int16_t butterfly[COLOR_NB][SQUARE_NB][SQUARE_NB];
+        Move    counterMoves[PIECE_NB][SQUARE_NB];
+    };
+    
+    // Moves an int16 entry towards the sign of bonus. The gravity term,
+    // proportional to the entry itself, keeps it within Limit as long as
+    // bonus is.
+    template<int Limit>
+    void gravity_update(int16_t& entry, int bonus) {
+        entry += bonus - entry * std::abs(bonus) / Limit;
+    }
+
+    // Minimum remaining depth at which ABDADA defers busy moves. Below it the
+    // subtrees are too small for the busy table traffic to pay off.
+    constexpr int ABDADA_MIN_DEPTH = 3;
+    
+    // Null move pruning: eval margin above beta worth one more ply of
+    // reduction, and remaining depth from which cutoffs are verified
+    constexpr int NULL_MOVE_EVAL_DIVISOR = 200;
+    constexpr int NULL_MOVE_VERIFY_DEPTH = 12;
+    
+    // ProbCut: minimum remaining depth, margin above beta and depth reduction
+    // of the capture searches
+    constexpr int   PROBCUT_MIN_DEPTH = 5;
+    constexpr Value PROBCUT_MARGIN    = 200;
+    constexpr int   PROBCUT_REDUCTION = 4;
+    
+    // Correction history entries are in 1/CORRECTION_GRAIN centipawns and
+    // bounded by CORRECTION_LIMIT
+    constexpr int CORRECTION_GRAIN = 8;
+    constexpr int CORRECTION_LIMIT = 8192;
+    
+    // Bound of the butterfly history entries, and of the bonus of one update
+    constexpr int HISTORY_LIMIT     = 16384;
+    constexpr int HISTORY_BONUS_MAX = 2048;
+    constexpr int MAX_QUIETS_SEARCHED = 64;
+    
+    // Move ordering: moves scoring at least SORT_LIMIT (TT move, captures and
+    // killers) are sorted up front and the others picked one at a time, as a
+    // cutoff often comes before them. From SORT_ALL_DEPTH on the subtrees are
+    // large enough for a full sort to pay off.
+    constexpr int SORT_LIMIT     = 799000;
+    constexpr int SORT_ALL_DEPTH = 4;
+    
+    // Sorts the moves of [begin, end) scoring at least limit in decreasing
+    // order at the front of the list. Returns the end of the sorted part.
+    ExtMove* partial_insertion_sort(ExtMove* begin, ExtMove* end, int limit) {
+        ExtMove* sortedEnd = begin;
+        for (ExtMove* p = begin; p < end; ++p)
+            if (p->value >= limit) {
+                ExtMove tmp = *p, *q;
+                *p = *sortedEnd;
+                for (q = sortedEnd; q != begin && *(q - 1) < tmp; --q)
+                    *q = *(q - 1);
+                *q = tmp;
+                ++sortedEnd;
+            }
+        return sortedEnd;
+    }
+    
+    // Moves the best scoring move of [cur, end) to cur
+    void pick_best(ExtMove* cur, ExtMove* end) {
+        std::swap(*cur, *std::max_element(cur, end));
+    }
+    
+    // Number of should_stop() calls between two reads of the clock
+    constexpr int TIME_CHECK_INTERVAL = 1024;
+    
+    // Time management: the main thread starts no new iteration once this
+    // share of the time limit, scaled by time_scale(), has passed. The time
+    // limit itself is the hard stop.
+    constexpr double SOFT_TIME_LIMIT = 0.7;
+
+    // Checkpoint files start with this tag and format version. Concurrent
+    // searches, as in batch mode, take turns writing the file.
+    constexpr uint32_t CHECKPOINT_MAGIC   = 0x54504B43;  // "CKPT"
+    constexpr uint32_t CHECKPOINT_VERSION = 1;
+    std::mutex checkpointMutex;
+
+    template<typename T>
+    void write_pod(std::ostream& out, const T& v) {
+        out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    template<typename T>
+    bool read_pod(std::istream& in, T& v) {
+        return bool(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+    }
+    
+    // The rule 50 counter is part of the cached context in steps of this
+    // many plies
+    constexpr int CACHE_RULE50_BUCKET = 8;
+    
+    // Everything but the root key that the result of a search depends on,
+    // hashed for the result cache: the limits, the options changing the
+    // search, the rule 50 counter and the positions since the last
+    // irreversible move, which the search treats as draws if it repeats
+    // them. FNV-1a, so that a cache file stays valid from one build to the
+    // next.
+    uint64_t cache_context(const Position& pos, int maxDepth, int timeMs) {
+        uint64_t h = 0xCBF29CE484222325ULL;
+        auto mix = [&](uint64_t v) {
+            for (int i = 0; i < 8; ++i, v >>= 8)
+                h = (h ^ (v & 0xFF)) * 0x100000001B3ULL;
+        };
+        
+        mix(uint64_t(maxDepth));
+        mix(uint64_t(timeMs));
+        mix(uint64_t(options.threads));
+        mix(options.hashMB);
+        mix(uint64_t(options.numaHistory));
+        mix(uint64_t(options.splitMode));
+        mix(uint64_t(options.driver));
+        mix(uint64_t(options.mctsLeafDepth));
+        for (char c : options.syzygyPath)
+            mix(uint64_t(uint8_t(c)));
+        mix(uint64_t(options.syzygyProbeDepth));
+        mix(uint64_t(options.syzygyProbeLimit));
+        mix(uint64_t(options.syzygy50MoveRule));
+        
+        mix(uint64_t(pos.rule50_count() / CACHE_RULE50_BUCKET));
+        
+        const StateInfo* st = pos.state();
+        for (int i = std::min(st->rule50, st->pliesFromNull); i > 0 && st->previous; --i) {
+            st = st->previous;
+            mix(st->key);
+        }
+        
+        return h;
+    }
+
+    // State shared by all threads taking part in one search
+    struct SharedState {
+        std::atomic<bool> stop{false};
+        std::chrono::steady_clock::time_point start;
+        int timeMs;
+        
+        // Root moves to search, restricted to the ones preserving the
+        // tablebase result when the root position is in the tablebases
+        std::vector<Move> rootMoves;
+        
+        // Tablebase probing: maximum number of pieces to probe inside the
+        // tree (0 disables it) and the score of the root when it is in the
+        // tablebases
+        int tbCardinality = 0;
+        bool rootInTB = false;
+        Value tbScore = VALUE_ZERO;
+        
+        // One history table per NUMA node when options.numaHistory is set.
+        // They belong to the search, as searches may run concurrently, and
+        // each is allocated zeroed by the first thread of its node that
+        // needs it, so that its pages live on that node.
+        std::vector<std::unique_ptr<History>> nodeHistory;
+        std::unique_ptr<std::once_flag[]> nodeHistoryOnce;
+    };
+    
+    // History table of the NUMA node the calling pool thread is bound to, or
+    // nullptr when each search thread keeps its own
+    History* node_history(SharedState& shared) {
+        if (shared.nodeHistory.empty())
+            return nullptr;
+        
+        int node = Numa::node_for_thread(ThreadPool::thread_index(), Threads.size());
+        std::call_once(shared.nodeHistoryOnce[node],
+                       [&] { shared.nodeHistory[node] = std::make_unique<History>(); });
+        return shared.nodeHistory[node].get();
+    }
+    
+    // Mate and tablebase scores are stored in the TT relative to the
+    // position they were found in rather than to the root
+    Value value_to_tt(Value v, int ply) {
+        return is_win(v) ? v + ply : is_loss(v) ? v - ply : v;
+    }
+    
+    Value value_from_tt(Value v, int ply) {
+        return is_win(v) ? v - ply : is_loss(v) ? v + ply : v;
+    }
+
+    // Node types of the search. PV nodes are searched with an open window
+    // and root is the PV node at ply 0; all other nodes get a null window.
+    enum NodeType {
+        NonPV,
+        PV,
+        Root
     };
     
-    constexpr int TT_SIZE = 1 << 20; // 1M entries
-    TTEntry tt[TT_SIZE];
+    // A root move with what the previous iterations learned about it: its
+    // score, the principal variation it leads to and the nodes spent on it.
+    // Only the best move gets an exact score, the others fail low.
+    struct RootMove {
+        explicit RootMove(Move m) : pv(1, m) {}
+        bool operator==(Move m) const { return pv[0] == m; }
+        
+        // Best first: by score, then by the effort the search put into the move
+        bool operator<(const RootMove& rm) const {
+            return rm.score != score ? rm.score < score : rm.nodes < nodes;
+        }
+        
+        Value score = -VALUE_INFINITE;
+        Value previousScore = -VALUE_INFINITE;
+        uint64_t nodes = 0;
+        std::vector<Move> pv;
+    };
+    
+    // Search state private to one thread. Helper threads run the same
+    // iterative deepening as the main thread on their own copy of the
+    // position and cooperate only through the shared transposition table
+    // (Lazy SMP).
+    class Worker {
+    public:
+        Worker(SharedState& sharedState, int threadIdx, History* sharedHistory);
+
+        SearchResult iterate(Position& pos, int maxDepth);
+        Value search_depth(Position& pos, int depth);
+
+        // Checkpoints of the main thread, see Search::search()
+        void save_checkpoint(const Position& pos, const SearchResult& result) const;
+        int load_checkpoint(const Position& pos);
+
+        uint64_t nodeCount = 0;
+
+    private:
+        int elapsed_ms() const;
+        double time_scale(Value score, Value previousScore, double bestMoveChanges) const;
+        int score_move(const Position& pos, Move m, Move tt_move, int ply) const;
+        void update_quiet_stats(const Position& pos, Move best, const Move* quiets,
+                                int quietCount, int depth, int ply);
+        ExtMove* score_moves(const Position& pos, const Move* first, const Move* last,
+                             ExtMove* moves, Move ttMove, int ply) const;
+        Value corrected_eval(const Position& pos) const;
+        void update_correction(const Position& pos, int depth, Value diff);
+        bool should_stop();
+        Value mtdf(Position& pos, int depth, Value guess);
+        template<NodeType nodeType>
+        Value qsearch(Position& pos, Value alpha, Value beta, int ply, Depth depth = DEPTH_QS);
+        template<NodeType nodeType>
+        Value alphabeta(Position& pos, int depth, Value alpha, Value beta, int ply, bool doNull = true);
+
+        SharedState& shared;
+        int idx;
+        int callsCount = TIME_CHECK_INTERVAL;
+        
+        // Root moves, kept sorted by the results of the last iteration, and
+        // the result of the last iteration of a resumed search
+        std::vector<RootMove> rootMoves;
+        SearchResult resumed{Move::none(), VALUE_ZERO, 0, 0, {}, 0};
+        
+        // Triangular principal variation table, pv[ply] holding the
+        // pvLength[ply] moves of the line found from that ply
+        Move pv[MAX_PLY + 1][MAX_PLY + 1];
+        int pvLength[MAX_PLY + 1];
+
+        // Move ordering state: the killer moves of each ply, the move made
+        // at each ply for the counter move lookup, and the history block,
+        // either our own or the one of our NUMA node
+        alignas(64) Move killerMoves[MAX_PLY][2];
+        Move currentMove[MAX_PLY + 1];
+        History ownHistory;
+        History* history;
+        
+        // Correction history: what the search found relative to the static
+        // eval, learned per pawn structure, minor piece placement and
+        // non-pawn placement of each color. Indexed by side to move and by
+        // the corresponding key.
+        static constexpr int CORRECTION_SIZE = 16384;
+        int16_t pawnCorrection[COLOR_NB][CORRECTION_SIZE];
+        int16_t minorCorrection[COLOR_NB][CORRECTION_SIZE];
+        int16_t nonPawnCorrection[COLOR_NB][COLOR_NB][CORRECTION_SIZE];
+    };
 }
 
 // MVV-LVA (Most Valuable Victim - Least Valuable Attacker) scores
@@ -58,8 +317,22 @@ constexpr int mvv_lva_scores[PIECE_TYPE_NB][PIECE_TYPE_NB] = {
     {0, 0, 0, 0, 0, 0, 0, 0}   // ALL_PIECES
 };
 
+Worker::Worker(SharedState& sharedState, int threadIdx, History* sharedHistory) :
+    shared(sharedState),
+    idx(threadIdx),
+    history(sharedHistory ? sharedHistory : &ownHistory) {
+
+    // Clear killer moves and our own history
+    std::memset(killerMoves, 0, sizeof(killerMoves));
+    std::memset(currentMove, 0, sizeof(currentMove));
+    std::memset(&ownHistory, 0, sizeof(ownHistory));
+    std::memset(pawnCorrection, 0, sizeof(pawnCorrection));
+    std::memset(minorCorrection, 0, sizeof(minorCorrection));
+    std::memset(nonPawnCorrection, 0, sizeof(nonPawnCorrection));
+}
+
 // Score a move for ordering
-int score_move(const Position& pos, Move m, Move tt_move, int ply) {
+int Worker::score_move(const Position& pos, Move m, Move tt_move, int ply) const {
     if (m == tt_move)
         return 1000000;
     
@@ -80,85 +353,240 @@ int score_move(const Position& pos, Move m, Move tt_move, int ply) {
     if (m == killerMoves[ply][1])
         return 799000;
     
+    // Counter move to the previous move
+    Move prev = ply > 0 ? currentMove[ply - 1] : Move::none();
+    if (prev.is_ok() && m == history->counterMoves[pos.piece_on(prev.to_sq())][prev.to_sq()])
+        return 790000;
+    
     // History heuristic
-    return history[color_of(moved)][m.from_sq()][to];
+    return history->butterfly[color_of(moved)][m.from_sq()][to];
+}
+
+// Update the ordering tables after a quiet move caused a beta cutoff: it
+// becomes a killer and the counter move to the previous move, its history
+// grows and the history of the quiet moves searched before it shrinks
+void Worker::update_quiet_stats(const Position& pos, Move best, const Move* quiets,
+                                int quietCount, int depth, int ply) {
+    if (killerMoves[ply][0] != best) {
+        killerMoves[ply][1] = killerMoves[ply][0];
+        killerMoves[ply][0] = best;
+    }
+    
+    Move prev = ply > 0 ? currentMove[ply - 1] : Move::none();
+    if (prev.is_ok())
+        history->counterMoves[pos.piece_on(prev.to_sq())][prev.to_sq()] = best;
+    
+    Color us = pos.side_to_move();
+    int bonus = std::min(32 * depth * depth, HISTORY_BONUS_MAX);
+    gravity_update<HISTORY_LIMIT>(history->butterfly[us][best.from_sq()][best.to_sq()], bonus);
+    for (int i = 0; i < quietCount; ++i)
+        gravity_update<HISTORY_LIMIT>(history->butterfly[us][quiets[i].from_sq()][quiets[i].to_sq()],
+                                      -bonus);
+}
+
+// Copy the moves of [first, last) to moves with their ordering scores.
+// Returns the end of the scored list.
+ExtMove* Worker::score_moves(const Position& pos, const Move* first, const Move* last,
+                             ExtMove* moves, Move ttMove, int ply) const {
+    for (const Move* m = first; m < last; ++m, ++moves) {
+        *moves = *m;
+        moves->value = score_move(pos, *m, ttMove, ply);
+    }
+    return moves;
+}
+
+// Static eval adjusted by the correction history
+Value Worker::corrected_eval(const Position& pos) const {
+    Color us = pos.side_to_move();
+    int correction = pawnCorrection[us][pos.pawn_key() % CORRECTION_SIZE]
+                   + minorCorrection[us][pos.minor_piece_key() % CORRECTION_SIZE]
+                   + nonPawnCorrection[us][WHITE][pos.non_pawn_key(WHITE) % CORRECTION_SIZE]
+                   + nonPawnCorrection[us][BLACK][pos.non_pawn_key(BLACK) % CORRECTION_SIZE];
+    
+    Value v = Eval::evaluate(pos) + correction / (2 * CORRECTION_GRAIN);
+    return std::clamp(v, VALUE_TB_LOSS_IN_MAX_PLY + 1, VALUE_TB_WIN_IN_MAX_PLY - 1);
+}
+
+// Move the correction entries of the position towards diff, the search
+// result minus the static eval, with a weight growing with depth. The
+// gravity term keeps entries within CORRECTION_LIMIT.
+void Worker::update_correction(const Position& pos, int depth, Value diff) {
+    int bonus = std::clamp(diff * CORRECTION_GRAIN * depth / 8, -CORRECTION_LIMIT / 4,
+                           CORRECTION_LIMIT / 4);
+    auto update = [bonus](int16_t& entry) { gravity_update<CORRECTION_LIMIT>(entry, bonus); };
+    
+    Color us = pos.side_to_move();
+    update(pawnCorrection[us][pos.pawn_key() % CORRECTION_SIZE]);
+    update(minorCorrection[us][pos.minor_piece_key() % CORRECTION_SIZE]);
+    update(nonPawnCorrection[us][WHITE][pos.non_pawn_key(WHITE) % CORRECTION_SIZE]);
+    update(nonPawnCorrection[us][BLACK][pos.non_pawn_key(BLACK) % CORRECTION_SIZE]);
 }
 
-// Check if we should stop searching
-bool should_stop() {
-    if (nodeCount % 2048 == 0) {
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now() - searchStart).count();
-        if (elapsed >= searchTimeMs) {
-            stopSearch = true;
+int Worker::elapsed_ms() const {
+    return int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - shared.start).count());
+}
+
+// Check if we should stop searching. The clock is read every
+// TIME_CHECK_INTERVAL calls, wherever in the tree they come from.
+bool Worker::should_stop() {
+    if (--callsCount <= 0) {
+        callsCount = TIME_CHECK_INTERVAL;
+        if (elapsed_ms() >= shared.timeMs) {
+            shared.stop = true;
         }
     }
-    return stopSearch;
+    return shared.stop.load(std::memory_order_relaxed);
 }
 
-// Quiescence search with capture search
-Value qsearch(Position& pos, Value alpha, Value beta, int ply) {
+// Share of the time limit worth spending after an iteration. A best move
+// that keeps changing or a score that moves asks for more time, while a
+// best move that took almost all the nodes of the search is unlikely to be
+// overturned and gets less.
+double Worker::time_scale(Value score, Value previousScore, double bestMoveChanges) const {
+    double instability = 1.0 + bestMoveChanges;
+    
+    double fluctuation = 1.0;
+    if (previousScore != -VALUE_INFINITE)
+        fluctuation += std::min(std::abs(score - previousScore), 100) / 200.0;
+    
+    double bestMoveEffort = nodeCount ? double(rootMoves[0].nodes) / nodeCount : 0.0;
+    double effort = std::clamp(1.5 - bestMoveEffort, 0.6, 1.2);
+    
+    return std::min(0.8 * instability * fluctuation * effort, 1.0);
+}
+
+// Quiescence search with capture search. At its first ply (depth DEPTH_QS)
+// quiet checks are searched as well, and in check the evasions.
+template<NodeType nodeType>
+Value Worker::qsearch(Position& pos, Value alpha, Value beta, int ply, Depth depth) {
+    static_assert(nodeType != Root);
+    constexpr bool PvNode = nodeType == PV;
+    
+    if (should_stop())
+        return VALUE_ZERO;
+    
     if (ply > MAX_PLY - 1)
         return Eval::evaluate(pos);
         
     nodeCount++;
     
-    Value stand_pat = Eval::evaluate(pos);
+    // Probe transposition table. Entries are stored at the depth of the
+    // move generation stage, evasions counting as the stage with checks.
+    bool inCheck = pos.checkers();
+    Depth ttDepth = inCheck || depth >= DEPTH_QS ? DEPTH_QS : DEPTH_QS_NO_CHECKS;
+    Key posKey = pos.key();
+    TTData tte;
+    bool ttHit = TT.probe(posKey, tte);
+    Move ttMove = ttHit ? tte.move : Move::none();
+    
+    if (!PvNode && ttHit && tte.depth >= ttDepth) {
+        Value ttValue = value_from_tt(tte.value, ply);
+        if (tte.bound == BOUND_EXACT
+            || (tte.bound == BOUND_LOWER && ttValue >= beta)
+            || (tte.bound == BOUND_UPPER && ttValue <= alpha))
+            return ttValue;
+    }
+    
+    Value originalAlpha = alpha;
+    Value bestScore = -VALUE_INFINITE;
     
-    if (stand_pat >= beta)
-        return beta;
-    if (alpha < stand_pat)
-        alpha = stand_pat;
+    // Standing pat is not an option in check, where all evasions are searched
+    if (!inCheck) {
+        bestScore = corrected_eval(pos);
+        
+        if (bestScore >= beta)
+            return bestScore;
+        if (alpha < bestScore)
+            alpha = bestScore;
+    }
     
     // Generate captures/checks
     Move moveList[MAX_MOVES];
-    Move* begin = moveList;
-    Move* end;
+    Move* last;
     
     // In check, search all evasions
-    if (pos.checkers()) {
-        end = generate<EVASIONS>(pos, begin);
+    if (inCheck) {
+        last = generate<EVASIONS>(pos, moveList);
     } else {
-        end = generate<CAPTURES>(pos, begin);
+        last = generate<CAPTURES>(pos, moveList);
+        if (depth >= DEPTH_QS)
+            last = generate<QUIET_CHECKS>(pos, last);
     }
     
     // Score and sort moves
-    int scores[MAX_MOVES];
-    for (Move* m = begin; m < end; ++m) {
-        scores[m - begin] = score_move(pos, *m, Move::none(), ply);
-    }
+    ExtMove moves[MAX_MOVES];
+    ExtMove* begin = moves;
+    ExtMove* end = score_moves(pos, moveList, last, begin, ttMove, ply);
+    ExtMove* sortedEnd = partial_insertion_sort(begin, end, SORT_LIMIT);
     
-    for (Move* m = begin; m < end; ++m) {
-        // Find best remaining move
-        Move* best = m;
-        for (Move* cur = m + 1; cur < end; ++cur) {
-            if (scores[cur - begin] > scores[best - begin])
-                best = cur;
-        }
-        if (best != m) {
-            std::swap(*m, *best);
-            std::swap(scores[m - begin], scores[best - begin]);
-        }
+    Move bestMove = Move::none();
+    bool anyLegal = false;
+    
+    for (ExtMove* m = begin; m < end; ++m) {
+        if (m >= sortedEnd)
+            pick_best(m, end);
         
         if (!pos.legal(*m))
             continue;
         
+        anyLegal = true;
+        
+        // Once a move has kept us from being mated, prune the moves that
+        // lose material, and in check the quiet evasions that remain
+        if (!is_loss(bestScore)) {
+            if (inCheck && !pos.capture_stage(*m))
+                continue;
+            if (!pos.see_ge(*m))
+                continue;
+        }
+        
+        currentMove[ply] = *m;
         StateInfo st;
         pos.do_move(*m, st, nullptr);
-        Value score = -qsearch(pos, -beta, -alpha, ply + 1);
+        Value score = -qsearch<nodeType>(pos, -beta, -alpha, ply + 1, depth - 1);
         pos.undo_move(*m);
         
-        if (score >= beta)
-            return beta;
-        if (score > alpha)
-            alpha = score;
+        // The score of an interrupted search is not to be stored
+        if (should_stop())
+            return bestScore;
+        
+        if (score > bestScore) {
+            bestScore = score;
+            
+            if (score >= beta) {
+                TT.store(posKey, *m, value_to_tt(score, ply), ttDepth, BOUND_LOWER);
+                return score;
+            }
+            if (score > alpha) {
+                alpha = score;
+                bestMove = *m;
+            }
+        }
     }
     
-    return alpha;
+    if (inCheck && !anyLegal)
+        return mated_in(ply);
+    
+    // Alpha raised by the stand pat or by a move is the exact qsearch value
+    TT.store(posKey, bestMove, value_to_tt(bestScore, ply), ttDepth,
+             bestScore > originalAlpha ? BOUND_EXACT : BOUND_UPPER);
+    
+    return bestScore;
 }
 
-// Alpha-beta search with TT, null move, and move ordering
-Value alphabeta(Position& pos, int depth, Value alpha, Value beta, int ply, bool doNull = true) {
+// Alpha-beta search with TT, null move, and move ordering. PV nodes use
+// principal variation search: the first move gets the open window and the
+// others a null window, re-searched as PV only when they land inside it.
+// TT cutoffs and pruning are restricted to non-PV nodes.
+template<NodeType nodeType>
+Value Worker::alphabeta(Position& pos, int depth, Value alpha, Value beta, int ply, bool doNull) {
+    constexpr bool PvNode = nodeType != NonPV;
+    constexpr bool rootNode = nodeType == Root;
+    
+    if constexpr (PvNode)
+        pvLength[ply] = 0;
+    
     if (should_stop())
         return VALUE_ZERO;
     
@@ -166,12 +594,12 @@ Value alphabeta(Position& pos, int depth, Value alpha, Value beta, int ply, bool
         return Eval::evaluate(pos);
         
     if (depth <= 0)
-        return qsearch(pos, alpha, beta, ply);
+        return qsearch<PvNode ? PV : NonPV>(pos, alpha, beta, ply);
     
     nodeCount++;
     
     // Check for draw
-    if (ply > 0 && (pos.is_draw(pos.game_ply()) || pos.rule50_count() >= 100))
+    if (!rootNode && (pos.is_draw(pos.game_ply()) || pos.rule50_count() >= 100))
         return VALUE_DRAW;
     
     bool inCheck = pos.checkers();
@@ -179,210 +607,686 @@ Value alphabeta(Position& pos, int depth, Value alpha, Value beta, int ply, bool
     
     // Probe transposition table
     Key posKey = pos.key();
-    int ttIndex = posKey % TT_SIZE;
-    TTEntry& tte = tt[ttIndex];
-    Move ttMove = Move::none();
-    
-    if (tte.key == posKey && tte.depth >= depth) {
-        ttMove = tte.best_move;
-        if (tte.flag == 0) { // Exact
-            return tte.value;
-        } else if (tte.flag == 1 && tte.value >= beta) { // Lower bound
-            return beta;
-        } else if (tte.flag == 2 && tte.value <= alpha) { // Upper bound
-            return alpha;
+    TTData tte;
+    bool ttHit = TT.probe(posKey, tte);
+    Move ttMove = ttHit ? tte.move : Move::none();
+    
+    if (!PvNode && ttHit && tte.depth >= depth) {
+        Value ttValue = value_from_tt(tte.value, ply);
+        if (tte.bound == BOUND_EXACT
+            || (tte.bound == BOUND_LOWER && ttValue >= beta)
+            || (tte.bound == BOUND_UPPER && ttValue <= alpha))
+            return ttValue;
+    }
+    
+    // Tablebase probe. WDL tables ignore the 50-move counter, so they are
+    // only probed right after a capture or pawn move.
+    if (!rootNode && shared.tbCardinality) {
+        int piecesCount = popcount(pos.pieces());
+        
+        if (piecesCount <= shared.tbCardinality
+            && (piecesCount < shared.tbCardinality || depth >= options.syzygyProbeDepth)
+            && pos.rule50_count() == 0 && !pos.can_castle(ANY_CASTLING)) {
+            Tablebases::ProbeState err;
+            Tablebases::WDLScore wdl = Tablebases::probe_wdl(pos, &err);
+            
+            if (err != Tablebases::FAIL) {
+                int drawScore = options.syzygy50MoveRule ? 1 : 0;
+                
+                // Wins and losses use the range between the mate scores and
+                // VALUE_TB_WIN_IN_MAX_PLY, preferring the shortest way in
+                Value value = wdl < -drawScore ? -VALUE_TB + ply
+                            : wdl > drawScore  ? VALUE_TB - ply
+                                               : VALUE_DRAW + 2 * wdl * drawScore;
+                
+                Bound b = wdl < -drawScore ? BOUND_UPPER
+                        : wdl > drawScore  ? BOUND_LOWER
+                                           : BOUND_EXACT;
+                
+                if (b == BOUND_EXACT || (b == BOUND_LOWER ? value >= beta : value <= alpha)) {
+                    TT.store(posKey, Move::none(), value_to_tt(value, ply),
+                             std::min(MAX_PLY - 1, depth + 6), b);
+                    return value;
+                }
+            }
         }
-    } else if (tte.key == posKey) {
-        ttMove = tte.best_move;
     }
     
-        // Null move pruning
-        if (doNull && !inCheck && depth >= 3 && ply > 0) {
+    // Nodes that get this far need their static eval, the ones cut off by
+    // the TT or the tablebases do not
+    Value staticEval = inCheck ? VALUE_NONE : corrected_eval(pos);
+    
+    // Null move pruning. The reduction grows with depth and with how far
+    // the static eval is above beta. It is skipped without non-pawn material,
+    // where zugzwang makes passing a bad guess, and at high depth a null move
+    // cutoff is only trusted after a verification search without null move.
+    if (!PvNode && doNull && !inCheck && depth >= 3 && !is_loss(beta) && staticEval >= beta
+        && pos.non_pawn_material(pos.side_to_move())) {
+        int R = 3 + depth / 4 + std::min(int(staticEval - beta) / NULL_MOVE_EVAL_DIVISOR, 3);
+        
+        currentMove[ply] = Move::null();
+        StateInfo st;
+        pos.do_null_move(st, TT);
+        Value nullScore = -alphabeta<NonPV>(pos, depth - R, -beta, -beta + 1, ply + 1, false);
+        pos.undo_null_move();
+        
+        // Mate scores found after passing are not proven
+        if (nullScore >= beta) {
+            nullScore = std::min(nullScore, VALUE_TB_WIN_IN_MAX_PLY - 1);
+            if (depth < NULL_MOVE_VERIFY_DEPTH)
+                return nullScore;
+            
+            Value v = alphabeta<NonPV>(pos, depth - R, beta - 1, beta, ply, false);
+            if (v >= beta)
+                return nullScore;
+        }
+    }
+    
+    // ProbCut: if a good capture beats beta by a margin at reduced depth,
+    // the full depth search would very likely fail high as well. Skipped
+    // when the TT already says that the node does not reach that margin.
+    Value probCutBeta = beta + PROBCUT_MARGIN;
+    if (!PvNode && !inCheck && depth >= PROBCUT_MIN_DEPTH && !is_decisive(beta)
+        && !(ttHit && tte.depth >= depth - 3 && value_from_tt(tte.value, ply) < probCutBeta)) {
+        Move captures[MAX_MOVES];
+        Move* capturesEnd = generate<CAPTURES>(pos, captures);
+        
+        for (Move* m = captures; m < capturesEnd; ++m) {
+            if (!pos.see_ge(*m) || !pos.legal(*m))
+                continue;
+            
+            currentMove[ply] = *m;
             StateInfo st;
-            pos.do_null_move(st, dummyTT);
-            Value nullScore = -alphabeta(pos, depth - 3, -beta, -beta + 1, ply + 1, false);
-            pos.undo_null_move();
+            pos.do_move(*m, st, nullptr);
             
-            if (nullScore >= beta)
-                return beta;
-        }    // Generate moves
-    Move moveList[MAX_MOVES];
-    Move* begin = moveList;
-    Move* end = generate<LEGAL>(pos, begin);
+            // A quick qsearch first, to skip captures that do not even hold there
+            Value value = -qsearch<NonPV>(pos, -probCutBeta, -probCutBeta + 1, ply + 1);
+            if (value >= probCutBeta)
+                value = -alphabeta<NonPV>(pos, depth - PROBCUT_REDUCTION, -probCutBeta,
+                                          -probCutBeta + 1, ply + 1);
+            pos.undo_move(*m);
+            
+            if (should_stop())
+                return VALUE_ZERO;
+            
+            if (value >= probCutBeta) {
+                TT.store(posKey, *m, value_to_tt(value, ply), depth - PROBCUT_REDUCTION + 1,
+                         BOUND_LOWER);
+                return is_decisive(value) ? beta : value - (probCutBeta - beta);
+            }
+        }
+    }
+    
+    // Generate and score moves. At the root they come from the root move
+    // list, which the tablebases may have restricted, and keep its order.
+    ExtMove moves[MAX_MOVES];
+    ExtMove* begin = moves;
+    ExtMove* end = begin;
+    if constexpr (rootNode)
+        for (const RootMove& rm : rootMoves) {
+            *end = rm.pv[0];
+            end->value = -int(end - begin);
+            ++end;
+        }
+    else {
+        Move moveList[MAX_MOVES];
+        end = score_moves(pos, moveList, generate<LEGAL>(pos, moveList), begin, ttMove, ply);
+    }
     
     // Checkmate or stalemate
     if (begin == end) {
         return inCheck ? mated_in(ply) : VALUE_DRAW;
     }
     
-    // Score and sort moves
-    int scores[MAX_MOVES];
-    for (Move* m = begin; m < end; ++m) {
-        scores[m - begin] = score_move(pos, *m, ttMove, ply);
-    }
+    ExtMove* sortedEnd =
+      rootNode || depth >= SORT_ALL_DEPTH ? partial_insertion_sort(begin, end, INT_MIN)
+                                          : partial_insertion_sort(begin, end, SORT_LIMIT);
     
     Value bestScore = -VALUE_INFINITE;
     Move bestMove = Move::none();
     
-    for (Move* m = begin; m < end; ++m) {
-        // Find best remaining move
-        Move* best = m;
-        for (Move* cur = m + 1; cur < end; ++cur) {
-            if (scores[cur - begin] > scores[best - begin])
-                best = cur;
-        }
-        if (best != m) {
-            std::swap(*m, *best);
-            std::swap(scores[m - begin], scores[best - begin]);
+    // ABDADA: after the first move, moves whose child position is being
+    // searched by another thread are deferred and searched after the others
+    bool abdada = !rootNode && options.splitMode == ABDADA && depth >= ABDADA_MIN_DEPTH;
+    Move deferred[MAX_MOVES];
+    int moveCount = end - begin;
+    int deferredCount = 0;
+    int searchedCount = 0;
+    
+    // Quiet moves searched without a cutoff, whose history is lowered when
+    // another quiet move cuts off
+    Move quietsSearched[MAX_QUIETS_SEARCHED];
+    int quietCount = 0;
+    
+    for (int i = 0; i < moveCount + deferredCount; ++i) {
+        Move m;
+        
+        if (i < moveCount) {
+            if (begin + i >= sortedEnd)
+                pick_best(begin + i, end);
+            m = begin[i];
+        } else {
+            m = deferred[i - moveCount];
         }
         
+        currentMove[ply] = m;
         StateInfo st;
-        pos.do_move(*m, st, nullptr);
-        Value score = -alphabeta(pos, depth - 1, -beta, -alpha, ply + 1, true);
-        pos.undo_move(*m);
+        pos.do_move(m, st, nullptr);
+        Key childKey = pos.key();
+        
+        if (abdada && i > 0 && i < moveCount && TT.is_busy(childKey)) {
+            pos.undo_move(m);
+            deferred[deferredCount++] = m;
+            continue;
+        }
+        
+        if (abdada)
+            TT.set_busy(childKey);
+        uint64_t nodesBefore = nodeCount;
+        Value score = -VALUE_INFINITE;
+        if (!PvNode || searchedCount > 0)
+            score = -alphabeta<NonPV>(pos, depth - 1, -alpha - 1, -alpha, ply + 1);
+        if (PvNode && (searchedCount == 0 || (score > alpha && score < beta)))
+            score = -alphabeta<PV>(pos, depth - 1, -beta, -alpha, ply + 1);
+        if (abdada)
+            TT.clear_busy(childKey);
+        pos.undo_move(m);
+        ++searchedCount;
         
         if (should_stop())
             return bestScore;
         
+        if (PvNode && score > alpha) {
+            pv[ply][0] = m;
+            std::copy(pv[ply + 1], pv[ply + 1] + pvLength[ply + 1], pv[ply] + 1);
+            pvLength[ply] = pvLength[ply + 1] + 1;
+        }
+        
+        if constexpr (rootNode) {
+            RootMove& rm = *std::find(rootMoves.begin(), rootMoves.end(), m);
+            rm.nodes += nodeCount - nodesBefore;
+            
+            // Moves failing low keep no score, so that the next iteration
+            // orders them by effort, except for the first one. Failing low it
+            // has no new PV and keeps its previous one.
+            if (score > alpha) {
+                rm.score = score;
+                rm.pv.assign(pv[ply], pv[ply] + pvLength[ply]);
+            } else
+                rm.score = searchedCount == 1 ? score : -VALUE_INFINITE;
+        }
+        
         if (score > bestScore) {
             bestScore = score;
-            bestMove = *m;
+            bestMove = m;
             
             if (score > alpha) {
                 alpha = score;
                 
                 if (alpha >= beta) {
                     // Beta cutoff - update killers and history
-                    if (!pos.capture(*m)) {
-                        // Update killer moves
-                        if (killerMoves[ply][0] != *m) {
-                            killerMoves[ply][1] = killerMoves[ply][0];
-                            killerMoves[ply][0] = *m;
-                        }
-                        
-                        // Update history heuristic
-                        Piece moved = pos.moved_piece(*m);
-                        history[color_of(moved)][m->from_sq()][m->to_sq()] += depth * depth;
-                    }
+                    if (!pos.capture_stage(m))
+                        update_quiet_stats(pos, m, quietsSearched, quietCount, depth, ply);
                     break;
                 }
             }
         }
+        
+        if (!pos.capture_stage(m) && quietCount < MAX_QUIETS_SEARCHED)
+            quietsSearched[quietCount++] = m;
     }
     
+    // Learn from quiet results only, where the static eval was not refuted
+    // by a capture, and only when the bound agrees with the direction of
+    // the error
+    if (!inCheck && !(bestMove && pos.capture(bestMove))
+        && !(bestScore >= beta && bestScore <= staticEval)
+        && !(bestScore <= originalAlpha && bestScore >= staticEval))
+        update_correction(pos, depth, bestScore - staticEval);
+    
     // Store in transposition table
-    tte.key = posKey;
-    tte.best_move = bestMove;
-    tte.value = bestScore;
-    tte.depth = depth;
-    if (bestScore <= originalAlpha)
-        tte.flag = 2; // Upper bound
-    else if (bestScore >= beta)
-        tte.flag = 1; // Lower bound
-    else
-        tte.flag = 0; // Exact
+    TT.store(posKey, bestMove, value_to_tt(bestScore, ply), depth,
+             bestScore <= originalAlpha ? BOUND_UPPER
+             : bestScore >= beta        ? BOUND_LOWER
+                                        : BOUND_EXACT);
     
     return bestScore;
 }
 
-// Iterative deepening search
-SearchResult search(Position& pos, int maxDepth, int timeMs) {
-    nodeCount = 0;
-    searchStart = std::chrono::steady_clock::now();
-    searchTimeMs = timeMs;
-    stopSearch = false;
+// MTD(f): converge on the score of the root with null window searches,
+// starting from a guess and narrowing the bounds after each fail high or
+// fail low. Only a search failing high tells which move is best: the root
+// moves are sorted after it so that this move is searched first by the next
+// ones and ends up first. A search failing low leaves the order as it is.
+Value Worker::mtdf(Position& pos, int depth, Value guess) {
+    Value score = guess;
+    Value lower = -VALUE_INFINITE, upper = VALUE_INFINITE;
     
-    // Clear killer moves and history
-    std::memset(killerMoves, 0, sizeof(killerMoves));
-    std::memset(history, 0, sizeof(history));
-    
-    SearchResult result;
-    result.bestMove = Move::none();
-    result.score = VALUE_ZERO;
-    result.depth = 0;
+    while (lower < upper) {
+        Value beta = std::max(score, lower + 1);
+        
+        // Scores left by other windows, or by moves the search does not
+        // reach after a cutoff, would mix bounds of different searches
+        for (RootMove& rm : rootMoves)
+            rm.score = -VALUE_INFINITE;
+        
+        score = alphabeta<Root>(pos, depth, beta - 1, beta, 0);
+        
+        if (should_stop())
+            break;
+        
+        if (score < beta)
+            upper = score;
+        else {
+            lower = score;
+            std::stable_sort(rootMoves.begin(), rootMoves.end());
+        }
+    }
     
-    // Generate root moves
-    Move rootMoves[MAX_MOVES];
-    Move* begin = rootMoves;
-    Move* end = generate<LEGAL>(pos, begin);
-    int numMoves = end - begin;
+    return score;
+}
+
+// Iterative deepening search. With Lazy SMP helper threads start at
+// alternating depths so that they do not all search the same iteration at
+// the same time. With ABDADA all threads search the same iteration and
+// split the work through the busy flags instead.
+SearchResult Worker::iterate(Position& pos, int maxDepth) {
+    SearchResult result = resumed;
     
-    // No legal moves
-    if (numMoves == 0) {
-        result.nodes = nodeCount;
-        return result;
+    // Root moves, possibly restricted by the tablebases, first ordered as
+    // in any other node unless restored from a checkpoint
+    if (rootMoves.empty()) {
+        for (Move m : shared.rootMoves)
+            rootMoves.emplace_back(m);
+        std::stable_sort(rootMoves.begin(), rootMoves.end(),
+                         [&](const RootMove& a, const RootMove& b) {
+                             return score_move(pos, a.pv[0], Move::none(), 0)
+                                  > score_move(pos, b.pv[0], Move::none(), 0);
+                         });
     }
     
-    // Only one legal move
-    if (numMoves == 1) {
-        result.bestMove = rootMoves[0];
-        result.score = VALUE_ZERO;
-        result.depth = 0;
-        result.nodes = nodeCount;
-        return result;
-    }
+    // Best move changes between iterations, decaying so that recent ones
+    // weigh more
+    double bestMoveChanges = 0.0;
     
-    Move prevBestMove = Move::none();
+    bool checkpoints = idx == 0 && !options.checkpointPath.empty();
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    int checkpointDepth = result.depth;
     
     // Iterative deepening
-    for (int depth = 1; depth <= maxDepth && depth <= 20; ++depth) {
+    int startDepth = result.depth ? result.depth + 1
+                   : options.splitMode == LAZY_SMP ? 1 + (idx & 1) : 1;
+    for (int depth = startDepth; depth <= maxDepth && depth <= 20; ++depth) {
         if (should_stop())
             break;
         
-        // Score and sort root moves
-        int scores[MAX_MOVES];
-        for (int i = 0; i < numMoves; ++i) {
-            scores[i] = score_move(pos, rootMoves[i], prevBestMove, 0);
-        }
+        for (RootMove& rm : rootMoves)
+            rm.previousScore = rm.score;
         
-        Value alpha = -VALUE_INFINITE;
-        Value beta = VALUE_INFINITE;
-        Move bestMove = Move::none();
-        Value bestScore = -VALUE_INFINITE;
-        
-        for (int i = 0; i < numMoves; ++i) {
-            // Find best remaining move
-            int best = i;
-            for (int j = i + 1; j < numMoves; ++j) {
-                if (scores[j] > scores[best])
-                    best = j;
-            }
-            if (best != i) {
-                std::swap(rootMoves[i], rootMoves[best]);
-                std::swap(scores[i], scores[best]);
-            }
-            
-            StateInfo st;
-            pos.do_move(rootMoves[i], st, nullptr);
-            Value score = -alphabeta(pos, depth - 1, -beta, -alpha, 1, true);
-            pos.undo_move(rootMoves[i]);
-            
-            if (should_stop())
-                break;
-            
-            if (score > bestScore) {
-                bestScore = score;
-                bestMove = rootMoves[i];
-                
-                if (score > alpha)
-                    alpha = score;
-            }
-        }
+        // MTD(f) takes its guess from the previous iteration
+        Value score = options.driver == MTDF && result.bestMove
+                    ? mtdf(pos, depth, result.score)
+                    : alphabeta<Root>(pos, depth, -VALUE_INFINITE, VALUE_INFINITE, 0);
+        
+        // An interrupted iteration is discarded, the move returned then
+        // being the best one of the last completed iteration
+        if (should_stop())
+            break;
+        
+        std::stable_sort(rootMoves.begin(), rootMoves.end());
+        
+        bestMoveChanges /= 2;
+        if (result.bestMove && rootMoves[0].pv[0] != result.bestMove)
+            bestMoveChanges += 1.0;
         
-        if (!should_stop() && bestMove != Move::none()) {
-            result.bestMove = bestMove;
-            result.score = bestScore;
-            result.depth = depth;
-            prevBestMove = bestMove;
+        Value previousScore = result.bestMove ? result.score : -VALUE_INFINITE;
+        result.bestMove = rootMoves[0].pv[0];
+        result.score = score;
+        result.depth = depth;
+        result.pv = rootMoves[0].pv;
+        
+        if (checkpoints
+            && std::chrono::steady_clock::now() - lastCheckpoint
+                 >= std::chrono::seconds(options.checkpointInterval)) {
+            save_checkpoint(pos, result);
+            lastCheckpoint = std::chrono::steady_clock::now();
+            checkpointDepth = depth;
         }
         
         // Stop if we found a mate
-        if (bestScore >= VALUE_MATE_IN_MAX_PLY || bestScore <= -VALUE_MATE_IN_MAX_PLY)
+        if (score >= VALUE_MATE_IN_MAX_PLY || score <= -VALUE_MATE_IN_MAX_PLY)
             break;
+        
+        // The main thread ends the search early once past the soft limit
+        // of the time the position deserves
+        if (idx == 0
+            && elapsed_ms() > shared.timeMs * SOFT_TIME_LIMIT
+                                * time_scale(score, previousScore, bestMoveChanges))
+            break;
+    }
+    
+    // Stopped before the first iteration completed: rather than no move,
+    // return the first root move, the best one by move ordering
+    if (!result.bestMove) {
+        result.bestMove = rootMoves[0].pv[0];
+        result.pv = {result.bestMove};
     }
     
+    if (checkpoints && result.depth > checkpointDepth)
+        save_checkpoint(pos, result);
+    
     result.nodes = nodeCount;
     return result;
 }
 
+// Checkpoint layout: tag, version and root FEN, the last completed depth
+// with its score and the nodes searched so far, the root moves in order
+// with their scores, nodes and PV, the history and correction tables and
+// the transposition table snapshot. The file is written next to its final
+// path and renamed over it, so an interrupted write leaves the previous
+// checkpoint intact.
+void Worker::save_checkpoint(const Position& pos, const SearchResult& result) const {
+    std::lock_guard<std::mutex> lock(checkpointMutex);
+    std::string tmpPath = options.checkpointPath + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary);
+    
+    std::string fen = pos.fen();
+    write_pod(out, CHECKPOINT_MAGIC);
+    write_pod(out, CHECKPOINT_VERSION);
+    write_pod(out, uint32_t(fen.size()));
+    out.write(fen.data(), fen.size());
+    
+    write_pod(out, int32_t(result.depth));
+    write_pod(out, int32_t(result.score));
+    write_pod(out, nodeCount);
+    
+    write_pod(out, uint32_t(rootMoves.size()));
+    for (const RootMove& rm : rootMoves) {
+        write_pod(out, int32_t(rm.score));
+        write_pod(out, int32_t(rm.previousScore));
+        write_pod(out, rm.nodes);
+        write_pod(out, uint32_t(rm.pv.size()));
+        for (Move m : rm.pv)
+            write_pod(out, m.raw());
+    }
+    
+    write_pod(out, *history);
+    write_pod(out, pawnCorrection);
+    write_pod(out, minorCorrection);
+    write_pod(out, nonPawnCorrection);
+    TT.save(out);
+    out.close();
+    
+    if (!out || std::rename(tmpPath.c_str(), options.checkpointPath.c_str()) != 0)
+        std::cerr << "Failed to write checkpoint " << options.checkpointPath << std::endl;
+}
+
+// Restores the state saved by save_checkpoint() when it was saved for pos
+// with the same root moves, and returns the depth saved or 0. A checkpoint
+// from a table of another size restores everything but the table.
+int Worker::load_checkpoint(const Position& pos) {
+    std::ifstream in(options.resumePath, std::ios::binary);
+    
+    uint32_t magic, version, fenSize;
+    if (!read_pod(in, magic) || magic != CHECKPOINT_MAGIC || !read_pod(in, version)
+        || version != CHECKPOINT_VERSION || !read_pod(in, fenSize) || fenSize > 128)
+        return 0;
+    
+    std::string fen(fenSize, ' ');
+    if (!in.read(fen.data(), fenSize) || fen != pos.fen())
+        return 0;
+    
+    int32_t depth, score, rmScore, rmPreviousScore;
+    uint64_t nodes, rmNodes;
+    uint32_t count, pvSize;
+    if (!read_pod(in, depth) || !read_pod(in, score) || !read_pod(in, nodes)
+        || !read_pod(in, count) || count != shared.rootMoves.size() || depth < 1 || depth >= MAX_PLY)
+        return 0;
+    
+    std::vector<RootMove> moves;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!read_pod(in, rmScore) || !read_pod(in, rmPreviousScore) || !read_pod(in, rmNodes)
+            || !read_pod(in, pvSize) || pvSize < 1 || pvSize > MAX_PLY)
+            return 0;
+        
+        std::vector<Move> pv(pvSize);
+        for (Move& m : pv) {
+            uint16_t raw;
+            if (!read_pod(in, raw))
+                return 0;
+            m = Move(raw);
+        }
+        
+        if (std::find(shared.rootMoves.begin(), shared.rootMoves.end(), pv[0]) == shared.rootMoves.end())
+            return 0;
+        
+        RootMove& rm = moves.emplace_back(pv[0]);
+        rm.score = Value(rmScore);
+        rm.previousScore = Value(rmPreviousScore);
+        rm.nodes = rmNodes;
+        rm.pv = pv;
+    }
+    
+    if (!read_pod(in, *history) || !read_pod(in, pawnCorrection) || !read_pod(in, minorCorrection)
+        || !read_pod(in, nonPawnCorrection)) {
+        std::memset(history, 0, sizeof(History));
+        std::memset(pawnCorrection, 0, sizeof(pawnCorrection));
+        std::memset(minorCorrection, 0, sizeof(minorCorrection));
+        std::memset(nonPawnCorrection, 0, sizeof(nonPawnCorrection));
+        return 0;
+    }
+    
+    if (!TT.load(in))
+        std::cerr << "Checkpoint " << options.resumePath << " has no complete transposition table of "
+                  << TT.size_mb() << "MB, the table is left as it was" << std::endl;
+    
+    rootMoves = std::move(moves);
+    nodeCount = nodes;
+    resumed = {rootMoves[0].pv[0], Value(score), depth, nodes, rootMoves[0].pv, 0};
+    return depth;
+}
+
+bool set_option(const std::string& name, const std::string& value) {
+    bool flag = value == "true" || value == "on" || value == "1";
+
+    if (name == "threads")
+        options.threads = std::max(1, std::stoi(value));
+    else if (name == "hash")
+        options.hashMB = std::max(1, std::stoi(value));
+    else if (name == "numa")
+        options.numaBind = flag;
+    else if (name == "numa-history")
+        options.numaHistory = flag;
+    else if (name == "smp" && (value == "lazy" || value == "abdada"))
+        options.splitMode = value == "lazy" ? LAZY_SMP : ABDADA;
+    else if (name == "driver" && (value == "full" || value == "mtdf"))
+        options.driver = value == "full" ? FULL_WINDOW : MTDF;
+    else if (name == "mcts-leaf-depth")
+        options.mctsLeafDepth = std::clamp(std::stoi(value), 0, 20);
+    else if (name == "tt-shm")
+        options.ttShm = value;
+    else if (name == "checkpoint")
+        options.checkpointPath = value;
+    else if (name == "checkpoint-interval")
+        options.checkpointInterval = std::max(0, std::stoi(value));
+    else if (name == "resume")
+        options.resumePath = value;
+    else if (name == "cache")
+        options.cacheMB = std::max(0, std::stoi(value));
+    else if (name == "cache-file")
+        options.cachePath = value;
+    else if (name == "syzygy-path")
+        options.syzygyPath = value;
+    else if (name == "syzygy-probe-depth")
+        options.syzygyProbeDepth = std::max(1, std::stoi(value));
+    else if (name == "syzygy-probe-limit")
+        options.syzygyProbeLimit = std::clamp(std::stoi(value), 0, 7);
+    else if (name == "syzygy-50-move-rule")
+        options.syzygy50MoveRule = flag;
+    else
+        return false;
+
+    return true;
+}
+
+void init() {
+    Threads.start(options.threads, options.numaBind);
+    TT.resize(options.hashMB, options.ttShm);
+    
+    if (!resultCache.resize(options.cacheMB, options.cachePath))
+        std::cerr << "Searching without a result cache" << std::endl;
+    
+    Tablebases::init(options.syzygyPath);
+    if (!options.syzygyPath.empty())
+        std::cerr << "Found " << Tablebases::MaxCardinality << "-piece tablebases in "
+                  << options.syzygyPath << std::endl;
+}
+
+// Open window search of one depth from a node that is not the root of an
+// iterative deepening search
+Value Worker::search_depth(Position& pos, int depth) {
+    return depth > 0 ? alphabeta<PV>(pos, depth, -VALUE_INFINITE, VALUE_INFINITE, 0)
+                     : qsearch<PV>(pos, -VALUE_INFINITE, VALUE_INFINITE, 0);
+}
+
+// The worker of a fixed depth search runs without time limit and without
+// tablebase probing, and lives as long as its FixedDepthSearch
+struct FixedDepthSearch::State {
+    SharedState shared;
+    std::unique_ptr<Worker> worker;
+};
+
+FixedDepthSearch::FixedDepthSearch() : state(std::make_unique<State>()) {
+    state->worker = std::make_unique<Worker>(state->shared, 0, nullptr);
+}
+
+FixedDepthSearch::~FixedDepthSearch() = default;
+
+Value FixedDepthSearch::search(Position& pos, int depth, int timeMs) {
+    state->shared.stop = false;
+    state->shared.start = std::chrono::steady_clock::now();
+    state->shared.timeMs = timeMs;
+    return state->worker->search_depth(pos, std::min(depth, MAX_PLY - 1));
+}
+
+bool FixedDepthSearch::stopped() const { return state->shared.stop; }
+
+uint64_t FixedDepthSearch::nodes() const { return state->worker->nodeCount; }
+
+SearchResult search(Position& pos, int maxDepth, int timeMs) {
+    SharedState shared;
+    shared.start = std::chrono::steady_clock::now();
+    shared.timeMs = timeMs;
+    
+    SearchResult result;
+    result.bestMove = Move::none();
+    result.score = VALUE_ZERO;
+    result.depth = 0;
+    result.nodes = 0;
+    
+    // Stamps the result with the time it took, for the returns below
+    auto finish = [&]() -> SearchResult& {
+        result.elapsedMs = int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() - shared.start).count());
+        return result;
+    };
+    
+    // Repeated requests are answered from the cache, apart from the ones
+    // of a checkpointed analysis, which should go deeper
+    uint64_t context = cache_context(pos, maxDepth, timeMs);
+    bool cached = options.checkpointPath.empty() && options.resumePath.empty();
+    if (cached && resultCache.probe(pos.key(), context, result))
+        return finish();
+    
+    MoveList<LEGAL> rootMoves(pos);
+    
+    // No legal moves
+    if (rootMoves.size() == 0)
+        return finish();
+    
+    // Only one legal move
+    if (rootMoves.size() == 1) {
+        result.bestMove = *rootMoves.begin();
+        return finish();
+    }
+    
+    shared.rootMoves.assign(rootMoves.begin(), rootMoves.end());
+    
+    // When the root is in the tablebases keep only the moves preserving its
+    // result. With DTZ tables that is enough to make progress, so there is
+    // no need to probe inside the tree. With WDL tables alone keep probing
+    // when winning, so that the search can find its way to a conversion.
+    shared.tbCardinality = std::min(options.syzygyProbeLimit, Tablebases::MaxCardinality);
+    if (shared.tbCardinality >= popcount(pos.pieces()) && !pos.can_castle(ANY_CASTLING)) {
+        bool dtz = Tablebases::root_probe(pos, shared.rootMoves, options.syzygy50MoveRule,
+                                          shared.tbScore);
+        shared.rootInTB = dtz
+                       || Tablebases::root_probe_wdl(pos, shared.rootMoves,
+                                                     options.syzygy50MoveRule, shared.tbScore);
+        
+        if (dtz || (shared.rootInTB && shared.tbScore <= VALUE_DRAW))
+            shared.tbCardinality = 0;
+        
+        if (shared.rootInTB && shared.rootMoves.size() == 1) {
+            result.bestMove = shared.rootMoves[0];
+            result.score = shared.tbScore;
+            return finish();
+        }
+    }
+    
+    if (options.numaHistory) {
+        shared.nodeHistory.resize(Numa::nodes().size());
+        shared.nodeHistoryOnce = std::make_unique<std::once_flag[]>(Numa::nodes().size());
+    }
+    
+    TT.new_search();
+    
+    // Workers are created by the pool thread that runs them, so that their
+    // tables are allocated on that thread's NUMA node. The main worker
+    // restores a checkpoint before the helpers start using the TT.
+    int threads = options.threads;
+    std::vector<std::unique_ptr<Worker>> workers(threads);
+    workers[0] = std::make_unique<Worker>(shared, 0, node_history(shared));
+    
+    if (!options.resumePath.empty())
+        if (int depth = workers[0]->load_checkpoint(pos))
+            std::cerr << "Resuming " << options.resumePath << " after depth " << depth << std::endl;
+    
+    // Helpers search their own copy of the root position. A helper that only
+    // gets a pool thread after the search is over returns immediately.
+    std::string fen = pos.fen();
+    TaskGroup helpers;
+    for (int idx = 1; idx < threads; ++idx)
+        Threads.submit(helpers, [&, idx] {
+            if (shared.stop)
+                return;
+            
+            StateInfo si;
+            Position helperPos;
+            helperPos.set(fen, pos.is_chess960(), &si);
+            workers[idx] = std::make_unique<Worker>(shared, idx, node_history(shared));
+            workers[idx]->iterate(helperPos, maxDepth);
+        });
+    
+    result = workers[0]->iterate(pos, maxDepth);
+    finish();
+    
+    shared.stop = true;
+    Threads.wait(helpers);
+    
+    // The search cannot see the tablebase result beyond its horizon
+    if (shared.rootInTB && !is_decisive(result.score))
+        result.score = shared.tbScore;
+    
+    result.nodes = 0;
+    for (auto& w : workers)
+        if (w)
+            result.nodes += w->nodeCount;
+    
+    if (cached && result.depth)
+        resultCache.store(pos.key(), context, result);
+    
+    return result;
+}
+
 }  // namespace Stockfish::Search
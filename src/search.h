@@ -1,7 +1,12 @@
 #ifndef SEARCH_H_INCLUDED
 #define SEARCH_H_INCLUDED
 
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 #include "types.h"
 
 namespace Stockfish {
@@ -15,10 +20,94 @@ struct SearchResult {
     Value score;
     int   depth;
     uint64_t nodes;
+    std::vector<Move> pv;  // Principal variation, starting with bestMove
+    int   elapsedMs;  // From the start of the search to its result, not counting
+                      // the wait for the helper threads to finish
 };
 
+// How the search threads of one search divide the work
+enum SplitMode {
+    LAZY_SMP,  // Independent searches sharing only the transposition table
+    ABDADA     // Threads defer moves that another thread is already searching
+};
+
+// How iterative deepening searches each depth
+enum Driver {
+    FULL_WINDOW,  // One search with an open window
+    MTDF          // Null window searches converging on the score (MTD(f))
+};
+
+// Engine options, set from the command line before the first search
+struct Options {
+    int    threads     = 1;      // Thread pool size, also the Lazy SMP threads per search
+    size_t hashMB      = 16;     // Transposition table size
+    bool   numaBind    = false;  // Pin search threads to cores grouped by NUMA node
+    bool   numaHistory = false;  // Share one history table per NUMA node
+    SplitMode splitMode = LAZY_SMP;
+    Driver    driver    = FULL_WINDOW;
+    int       mctsLeafDepth = 1;  // Depth of the leaf searches of MCTS, 0 for qsearch
+    std::string ttShm;            // POSIX shared memory segment holding the TT, empty for a private one
+
+    std::string checkpointPath;           // File the search state is saved to, empty to disable
+    int         checkpointInterval = 60;  // Minimum seconds between two checkpoints
+    std::string resumePath;               // Checkpoint a search of the same position continues from
+
+    size_t      cacheMB = 0;  // Cache of search results by position and limits, 0 to disable
+    std::string cachePath;    // File keeping the cached results across runs, empty for memory only
+
+    std::string syzygyPath;               // Syzygy directories separated by ':', empty to disable
+    int         syzygyProbeDepth = 1;     // Minimum depth to probe tables of the largest size
+    int         syzygyProbeLimit = 7;     // Maximum number of pieces to probe
+    bool        syzygy50MoveRule = true;  // Score wins and losses spoiled by the 50-move rule as draws
+};
+
+extern Options options;
+
+// Sets an option from its command line name and value.
+// Returns false if the name is not a known option.
+bool set_option(const std::string& name, const std::string& value);
+
+// Allocates the tables sized by the options. Must be called after the
+// options are set and before searching.
+void init();
+
+// Iterative deepening search of pos on options.threads threads.
+//
+// With options.checkpointPath set, the main thread saves the state of the
+// search after the iterations completing checkpointInterval seconds after
+// the previous checkpoint, and at the end of the search: the root position,
+// the last completed depth, the root moves with their scores, its history
+// and correction tables and a snapshot of the transposition table. A search
+// of the position saved in options.resumePath restores that state and
+// continues with the next depth.
+//
+// With options.cacheMB set, a search of a position already searched with
+// the same limits returns the cached result instead, unless it takes part
+// in checkpointing.
 SearchResult search(Position& pos, int maxDepth, int timeMs);
 
+// Fixed depth search for other search modes, such as leaf evaluation in
+// MCTS. Move ordering and correction tables persist between calls, so an
+// instance must not be shared between threads.
+class FixedDepthSearch {
+public:
+    FixedDepthSearch();
+    ~FixedDepthSearch();
+
+    // Score of pos for the side to move from an open window search of the
+    // given depth, 0 being a quiescence search. A search that runs out of
+    // timeMs is stopped and its score is meaningless.
+    Value search(Position& pos, int depth, int timeMs = INT_MAX);
+    bool  stopped() const;
+
+    // Nodes searched by all the calls so far
+    uint64_t nodes() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+};
+
 }  // namespace Search
 
 }  // namespace Stockfish
@@ -0,0 +1,68 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TBPROBE_H_INCLUDED
+#define TBPROBE_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace Stockfish {
+class Position;
+}
+
+namespace Stockfish::Tablebases {
+
+enum WDLScore {
+    WDLLoss        = -2,  // Loss
+    WDLBlessedLoss = -1,  // Loss, but draw under 50-move rule
+    WDLDraw        = 0,   // Draw
+    WDLCursedWin   = 1,   // Win, but draw under 50-move rule
+    WDLWin         = 2,   // Win
+};
+
+// Possible states after a probing operation
+enum ProbeState {
+    FAIL              = 0,   // Probe failed (missing file table)
+    OK                = 1,   // Probe successful
+    CHANGE_STM        = -1,  // DTZ should check the other side
+    ZEROING_BEST_MOVE = 2    // Best move zeroes DTZ (capture or pawn move)
+};
+
+// Largest number of pieces of the tables found by init()
+extern int MaxCardinality;
+
+// Registers the tables found in the given directories, separated by ':'.
+// Files are only memory mapped when they are first probed.
+void     init(const std::string& paths);
+WDLScore probe_wdl(Position& pos, ProbeState* result);
+int      probe_dtz(Position& pos, ProbeState* result);
+
+// Keep only the root moves that preserve the best tablebase result, ranked
+// by DTZ or, when DTZ tables are missing, by WDL. tbScore receives the score
+// of the best result. They return false, leaving rootMoves untouched, if
+// some probe failed.
+bool root_probe(Position& pos, std::vector<Move>& rootMoves, bool rule50, Value& tbScore);
+bool root_probe_wdl(Position& pos, std::vector<Move>& rootMoves, bool rule50, Value& tbScore);
+
+}  // namespace Stockfish::Tablebases
+
+#endif
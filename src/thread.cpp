@@ -0,0 +1,182 @@
+#include "thread.h"
+
+#include <chrono>
+
+#include "numa.h"
+
+namespace Stockfish {
+
+ThreadPool Threads;
+
+namespace {
+    thread_local int threadIdx = 0;
+}
+
+ThreadPool::~ThreadPool() { stop_workers(); }
+
+int ThreadPool::thread_index() { return threadIdx; }
+
+// Marks one task of the group as done. The counter is decremented under the
+// group mutex so that wait() cannot return, and the group go out of scope,
+// while we still hold it.
+void ThreadPool::complete(TaskGroup& group) {
+    std::lock_guard<std::mutex> lk(group.mutex);
+    if (--group.pending == 0)
+        group.done.notify_all();
+}
+
+void ThreadPool::stop_workers() {
+    exit = true;
+    {
+        std::lock_guard<std::mutex> lk(sleepMutex);
+    }
+    sleepCondition.notify_all();
+
+    for (auto& w : workers)
+        w->thread.join();
+
+    workers.clear();
+    exit = false;
+}
+
+void ThreadPool::start(int threadCount, bool numaBind) {
+    stop_workers();
+
+    if (numaBind)
+        Numa::bind_this_thread(0, threadCount);
+
+    // Create all deques before any worker starts stealing from them
+    for (int i = 1; i < threadCount; ++i)
+        workers.push_back(std::make_unique<Worker>());
+
+    for (int i = 1; i < threadCount; ++i)
+        workers[i - 1]->thread = std::thread([this, i, threadCount, numaBind] {
+            threadIdx = i;
+            if (numaBind)
+                Numa::bind_this_thread(i, threadCount);
+            idle_loop(i);
+        });
+}
+
+void ThreadPool::notify() {
+    {
+        std::lock_guard<std::mutex> lk(sleepMutex);
+    }
+    sleepCondition.notify_all();
+}
+
+void ThreadPool::idle_loop(int idx) {
+    while (!exit)
+    {
+        if (run_one(idx))
+            continue;
+
+        std::unique_lock<std::mutex> lk(sleepMutex);
+        sleepCondition.wait(lk, [&] { return exit || queued > 0; });
+    }
+}
+
+bool ThreadPool::pop(Worker& w, bool back, Task& task) {
+    std::lock_guard<std::mutex> lk(w.mutex);
+
+    if (w.tasks.empty())
+        return false;
+
+    if (back)
+    {
+        task = std::move(w.tasks.back());
+        w.tasks.pop_back();
+    }
+    else
+    {
+        task = std::move(w.tasks.front());
+        w.tasks.pop_front();
+    }
+    return true;
+}
+
+// Runs one pending task if any: first the tasks bound to us, then our own
+// deque (newest first), then the oldest task of the other deques.
+bool ThreadPool::run_one(int idx) {
+    Task task;
+    bool found = false;
+
+    if (idx > 0)
+    {
+        Worker&                     own = *workers[idx - 1];
+        std::lock_guard<std::mutex> lk(own.mutex);
+        if (!own.bound.empty())
+        {
+            task = std::move(own.bound.front());
+            own.bound.pop_front();
+            found = true;
+        }
+    }
+
+    found = found || pop(idx > 0 ? *workers[idx - 1] : external, true, task);
+
+    for (size_t i = 0; !found && i <= workers.size(); ++i)
+    {
+        size_t victim = (idx + i) % (workers.size() + 1);
+        found         = victim != size_t(idx) && pop(victim ? *workers[victim - 1] : external, false, task);
+    }
+
+    if (!found)
+        return false;
+
+    --queued;
+    task();
+    return true;
+}
+
+void ThreadPool::submit(TaskGroup& group, Task task) {
+    ++group.pending;
+
+    Task wrapped = [&group, task = std::move(task)] {
+        task();
+        complete(group);
+    };
+
+    Worker& w = threadIdx > 0 && threadIdx <= int(workers.size()) ? *workers[threadIdx - 1] : external;
+    {
+        std::lock_guard<std::mutex> lk(w.mutex);
+        w.tasks.push_back(std::move(wrapped));
+    }
+
+    ++queued;
+    notify();
+}
+
+void ThreadPool::wait(TaskGroup& group) {
+    while (group.pending > 0)
+    {
+        if (run_one(threadIdx))
+            continue;
+
+        std::unique_lock<std::mutex> lk(group.mutex);
+        group.done.wait_for(lk, std::chrono::milliseconds(1), [&] { return group.pending == 0; });
+    }
+
+    std::lock_guard<std::mutex> lk(group.mutex);
+}
+
+void ThreadPool::run_on_all(const std::function<void(int)>& fn) {
+    TaskGroup group;
+
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        ++group.pending;
+        std::lock_guard<std::mutex> lk(workers[i]->mutex);
+        workers[i]->bound.push_back([&fn, &group, i] {
+            fn(int(i) + 1);
+            complete(group);
+        });
+        ++queued;
+    }
+
+    notify();
+    fn(0);
+    wait(group);
+}
+
+}  // namespace Stockfish
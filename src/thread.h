@@ -0,0 +1,102 @@
+#ifndef THREAD_H_INCLUDED
+#define THREAD_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Stockfish {
+
+// A set of tasks that can be waited for as a whole
+class TaskGroup {
+   public:
+    TaskGroup()                            = default;
+    TaskGroup(const TaskGroup&)            = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+   private:
+    friend class ThreadPool;
+
+    std::atomic<int>        pending{0};
+    std::mutex              mutex;
+    std::condition_variable done;
+};
+
+// Engine-wide work-stealing thread pool shared by the search and the command
+// line modes, so that nested parallelism (e.g. batch analysis running
+// multithreaded searches) never creates more threads than configured.
+//
+// Every worker owns a deque: it pushes and pops its own tasks at the back and
+// steals from the front of the other deques when it runs dry. Tasks submitted
+// from outside the pool go to a shared deque. Idle workers sleep on a
+// condition variable, and a thread waiting for a task group runs pending
+// tasks meanwhile, so waiting inside a task cannot deadlock the pool.
+class ThreadPool {
+   public:
+    using Task = std::function<void()>;
+
+    ~ThreadPool();
+
+    // (Re)starts the pool so that, together with the calling thread, there
+    // are threadCount threads in total. With numaBind, thread i is pinned as
+    // the i-th search thread (the calling thread being thread 0).
+    void start(int threadCount, bool numaBind);
+
+    // Total number of threads, including the one driving the pool
+    int size() const { return int(workers.size()) + 1; }
+
+    // Index of the calling thread: 1..size()-1 for workers, 0 otherwise
+    static int thread_index();
+
+    void submit(TaskGroup& group, Task task);
+    void wait(TaskGroup& group);
+
+    // Runs fn(threadIdx) once on every thread of the pool, the calling thread
+    // included, and waits for all of them. The tasks are bound to their
+    // threads and never stolen, which is what first-touch allocation needs.
+    void run_on_all(const std::function<void(int)>& fn);
+
+    // Runs fn(i) for every i in [begin, end) and waits for completion
+    template<typename F>
+    void parallel_for(size_t begin, size_t end, F&& fn) {
+        TaskGroup group;
+        for (size_t i = begin; i < end; ++i)
+            submit(group, [&fn, i] { fn(i); });
+        wait(group);
+    }
+
+   private:
+    struct Worker {
+        std::mutex       mutex;
+        std::deque<Task> tasks;
+        std::deque<Task> bound;  // Tasks that must run on this worker only
+        std::thread      thread;
+    };
+
+    static void complete(TaskGroup& group);
+
+    void idle_loop(int idx);
+    bool run_one(int idx);
+    bool pop(Worker& w, bool back, Task& task);
+    void notify();
+    void stop_workers();
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    Worker                               external;  // Tasks submitted from outside the pool
+    std::atomic<int>                     queued{0};
+    std::atomic<bool>                    exit{false};
+    std::mutex                           sleepMutex;
+    std::condition_variable              sleepCondition;
+};
+
+extern ThreadPool Threads;
+
+}  // namespace Stockfish
+
+#endif // THREAD_H_INCLUDED
@@ -0,0 +1,257 @@
+#include "tt.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <cerrno>
+    #include <chrono>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <thread>
+    #include <unistd.h>
+#endif
+
+#include "thread.h"
+
+namespace Stockfish {
+
+TranspositionTable TT;
+
+namespace {
+
+// An entry of the same position is only kept if it is deeper than the new
+// result by more than this, as a slightly deeper bound is soon outdated by
+// the next iteration anyway
+constexpr int SAME_KEY_DEPTH_MARGIN = 3;
+
+// Payload layout: move (16 bits) | value (16 bits) | depth (8 bits) | bound (8 bits)
+// | generation (8 bits)
+uint64_t pack(Move move, Value value, Depth depth, Bound bound, uint8_t generation) {
+    return uint64_t(move.raw()) | uint64_t(uint16_t(int16_t(value))) << 16
+         | uint64_t(uint8_t(int8_t(depth))) << 32 | uint64_t(uint8_t(bound)) << 40
+         | uint64_t(generation) << 48;
+}
+
+uint8_t generation_of(uint64_t data) { return uint8_t(data >> 48); }
+
+TTData unpack(uint64_t data) {
+    return {Move(uint16_t(data)), Value(int16_t(data >> 16)), Depth(int8_t(data >> 32)),
+            Bound(uint8_t(data >> 40))};
+}
+
+// Entries per block read or written by save() and load()
+constexpr size_t SNAPSHOT_BLOCK = 1 << 16;
+
+// Entries shared between processes must not rely on a lock living in one
+// process' memory
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+}  // namespace
+
+TranspositionTable::~TranspositionTable() { release(); }
+
+void TranspositionTable::release() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (shared)
+    {
+        munmap(table, entryCount * sizeof(Entry));
+        table  = nullptr;
+        shared = false;
+        return;
+    }
+#endif
+    std::free(table);
+    table = nullptr;
+}
+
+void TranspositionTable::resize(size_t newMbSize, const std::string& shmName) {
+    release();
+
+    mbSize     = newMbSize;
+    entryCount = mbSize * 1024 * 1024 / sizeof(Entry);
+
+    if (!shmName.empty())
+    {
+        if (!attach_shared(shmName))
+        {
+            std::cerr << "Failed to attach shared transposition table " << shmName << "."
+                      << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        return;
+    }
+
+    table = static_cast<Entry*>(std::aligned_alloc(64, entryCount * sizeof(Entry)));
+
+    if (!table)
+    {
+        std::cerr << "Failed to allocate " << mbSize << "MB for transposition table." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    clear();
+}
+
+// Maps the shared memory segment shmName as the table. The process that
+// creates the segment sizes it, which zeroes it; the others wait for that
+// and check that they asked for the same size.
+bool TranspositionTable::attach_shared(const std::string& shmName) {
+#if defined(__unix__) || defined(__APPLE__)
+    std::string name  = shmName[0] == '/' ? shmName : "/" + shmName;
+    size_t      bytes = entryCount * sizeof(Entry);
+
+    int  fd      = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    bool created = fd >= 0;
+
+    if (created)
+    {
+        if (ftruncate(fd, off_t(bytes)) != 0)
+        {
+            close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+    }
+    else
+    {
+        if (errno != EEXIST || (fd = shm_open(name.c_str(), O_RDWR, 0600)) < 0)
+            return false;
+
+        struct stat st {};
+        for (int tries = 0; fstat(fd, &st) == 0 && st.st_size == 0 && tries < 1000; ++tries)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        if (size_t(st.st_size) != bytes)
+        {
+            std::cerr << "Shared transposition table " << shmName << " has "
+                      << st.st_size / (1024 * 1024) << "MB, not " << mbSize << "MB." << std::endl;
+            close(fd);
+            return false;
+        }
+    }
+
+    void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED)
+        return false;
+
+    table  = static_cast<Entry*>(mem);
+    shared = true;
+    return true;
+#else
+    (void) shmName;
+    return false;
+#endif
+}
+
+// Zeroes the table in parallel, one slice per pool thread. Entries are
+// addressed by hash, so no thread favours any slice: this only spreads the
+// first touch, hence the pages, evenly across the NUMA nodes of the threads.
+void TranspositionTable::clear() {
+    int threadCount = Threads.size();
+
+    Threads.run_on_all([=](int idx) {
+        size_t stride = entryCount / threadCount;
+        size_t start  = stride * idx;
+        size_t len    = idx == threadCount - 1 ? entryCount - start : stride;
+
+        for (size_t i = start; i < start + len; ++i)
+        {
+            table[i].keyXorData.store(0, std::memory_order_relaxed);
+            table[i].data.store(0, std::memory_order_relaxed);
+        }
+    });
+}
+
+bool TranspositionTable::probe(Key key, TTData& ttData) const {
+    const Entry* e    = entry(key);
+    uint64_t     data = e->data.load(std::memory_order_relaxed);
+
+    if ((e->keyXorData.load(std::memory_order_relaxed) ^ data) != key)
+        return false;
+
+    ttData = unpack(data);
+    return true;
+}
+
+// Replacement policy: an entry from the current search that is deeper than
+// the new result is kept, unless that result is exact. For the same position
+// it has to be deeper by more than SAME_KEY_DEPTH_MARGIN. So the many shallow
+// qsearch stores do not evict the deep entries of the main search, nor the
+// bound and move of the same position searched deeper. A new result of the
+// same position without a move keeps the stored one.
+void TranspositionTable::store(Key key, Move move, Value value, Depth depth, Bound bound) {
+    Entry*   e       = entry(key);
+    uint64_t oldData = e->data.load(std::memory_order_relaxed);
+
+    bool sameKey = (e->keyXorData.load(std::memory_order_relaxed) ^ oldData) == key;
+
+    if (oldData && bound != BOUND_EXACT && generation_of(oldData) == generation8
+        && unpack(oldData).depth > depth + (sameKey ? SAME_KEY_DEPTH_MARGIN : 0))
+        return;
+
+    if (!move && sameKey)
+        move = unpack(oldData).move;
+
+    uint64_t data = pack(move, value, depth, bound, generation8);
+
+    e->keyXorData.store(key ^ data, std::memory_order_relaxed);
+    e->data.store(data, std::memory_order_relaxed);
+}
+
+// Snapshot layout: the table size in MB, then both words of every entry
+void TranspositionTable::save(std::ostream& out) const {
+    uint64_t size = mbSize;
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+
+    std::vector<uint64_t> block(2 * SNAPSHOT_BLOCK);
+    for (size_t first = 0; first < entryCount; first += SNAPSHOT_BLOCK)
+    {
+        size_t count = std::min(SNAPSHOT_BLOCK, entryCount - first);
+        for (size_t i = 0; i < count; ++i)
+        {
+            block[2 * i]     = table[first + i].keyXorData.load(std::memory_order_relaxed);
+            block[2 * i + 1] = table[first + i].data.load(std::memory_order_relaxed);
+        }
+        out.write(reinterpret_cast<const char*>(block.data()), count * 2 * sizeof(uint64_t));
+    }
+}
+
+// The table may be shared with other processes, so nothing is written to it
+// before the whole snapshot is known to be in the stream
+bool TranspositionTable::load(std::istream& in) {
+    uint64_t size;
+    if (!in.read(reinterpret_cast<char*>(&size), sizeof(size)) || size != mbSize)
+        return false;
+
+    std::streampos start = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streampos end = in.tellg();
+    in.seekg(start);
+    if (start == std::streampos(-1) || end == std::streampos(-1)
+        || uint64_t(end - start) < entryCount * 2 * sizeof(uint64_t))
+        return false;
+
+    std::vector<uint64_t> block(2 * SNAPSHOT_BLOCK);
+    for (size_t first = 0; first < entryCount; first += SNAPSHOT_BLOCK)
+    {
+        size_t count = std::min(SNAPSHOT_BLOCK, entryCount - first);
+        if (!in.read(reinterpret_cast<char*>(block.data()), count * 2 * sizeof(uint64_t)))
+            return false;
+        for (size_t i = 0; i < count; ++i)
+        {
+            table[first + i].keyXorData.store(block[2 * i], std::memory_order_relaxed);
+            table[first + i].data.store(block[2 * i + 1], std::memory_order_relaxed);
+        }
+    }
+    return true;
+}
+
+void TranspositionTable::prefetch(Key key) const { Stockfish::prefetch(entry(key)); }
+
+}  // namespace Stockfish
@@ -0,0 +1,97 @@
+#ifndef TT_H_INCLUDED
+#define TT_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "misc.h"
+#include "types.h"
+
+namespace Stockfish {
+
+// Search data read back from a transposition table entry
+struct TTData {
+    Move  move;
+    Value value;
+    Depth depth;
+    Bound bound;
+};
+
+// Transposition table shared by all search threads. Entries are lockless:
+// each one stores its packed payload together with the position key xored
+// with that payload, so an entry torn by two concurrent writers simply fails
+// the key check on the next probe instead of returning mixed data.
+class TranspositionTable {
+   public:
+    ~TranspositionTable();
+
+    // Reallocates the table. The memory is not touched here: clear() zeroes
+    // it in slices from every thread of the pool, so with NUMA binding the
+    // pages end up interleaved across the nodes of the bound threads.
+    //
+    // With a shmName the table is instead the POSIX shared memory segment of
+    // that name, created zeroed by the first process and attached as is by
+    // the others, which then share their search results. The segment
+    // outlives the processes until it is removed (/dev/shm/<name> on Linux).
+    void resize(size_t mbSize, const std::string& shmName = "");
+    void clear();
+
+    bool probe(Key key, TTData& data) const;
+    void store(Key key, Move move, Value value, Depth depth, Bound bound);
+    void prefetch(Key key) const;
+
+    size_t size_mb() const { return mbSize; }
+
+    // Starts a new search: entries from earlier searches become stale and
+    // are replaced regardless of their depth
+    void new_search() { generation8.fetch_add(1, std::memory_order_relaxed); }
+
+    // Snapshot of the entries for search checkpoints. It may be taken while
+    // searching, as torn entries fail the key check anyway. load() fails on
+    // a snapshot of a table of another size or a truncated one, leaving the
+    // table as it was.
+    void save(std::ostream& out) const;
+    bool load(std::istream& in);
+
+    // Busy flags for ABDADA: a thread marks a position while it searches
+    // it, so that other threads can defer that move and search another one.
+    // Colliding keys only cause a spurious deferral.
+    bool is_busy(Key key) const {
+        return busy[key & (BUSY_SIZE - 1)].load(std::memory_order_relaxed) == key;
+    }
+    void set_busy(Key key) { busy[key & (BUSY_SIZE - 1)].store(key, std::memory_order_relaxed); }
+    void clear_busy(Key key) {
+        busy[key & (BUSY_SIZE - 1)].compare_exchange_strong(key, 0, std::memory_order_relaxed);
+    }
+
+   private:
+    struct Entry {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+
+    Entry* entry(Key key) const { return &table[mul_hi64(key, entryCount)]; }
+
+    static constexpr size_t BUSY_SIZE = 1 << 15;
+
+    std::atomic<Key> busy[BUSY_SIZE];
+
+    bool attach_shared(const std::string& shmName);
+    void release();
+
+    Entry* table      = nullptr;
+    size_t entryCount = 0;
+    size_t mbSize     = 0;
+    bool   shared     = false;
+
+    std::atomic<uint8_t> generation8{0};
+};
+
+extern TranspositionTable TT;
+
+}  // namespace Stockfish
+
+#endif // TT_H_INCLUDED
@@ -0,0 +1,75 @@
+#!/bin/sh
+# Smoke tests run by "make check": move generation against known perft
+# counts, short searches of a few positions with both search drivers, and
+# tablebase probing, with real tables only if SYZYGY_PATH names them.
+# Usage: tests/check.sh <engine>
+
+ENGINE=${1:-./engine}
+DIR=$(dirname "$0")
+failures=0
+
+fail() {
+    echo "FAIL: $1"
+    failures=$((failures + 1))
+}
+
+perft() {
+    expected=$1
+    shift
+    nodes=$("$ENGINE" --perft "$@" | sed -n 's/^Nodes searched: //p')
+    [ "$nodes" = "$expected" ] || fail "perft $* gave '$nodes', expected $expected"
+}
+
+perft 4865609 5 rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1
+perft 4085603 4 r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1
+
+# Every search returns a move, also when stopped early, and finds the mate
+for driver in full mtdf; do
+    for ms in 1 200; do
+        out=$("$ENGINE" --driver $driver --batch "$DIR/positions.fen" $ms) \
+            || fail "--driver $driver --batch at ${ms}ms exited with status $?"
+
+        [ "$(echo "$out" | grep -c 'Best move: ')" = "$(wc -l < "$DIR/positions.fen")" ] \
+            || fail "--driver $driver --batch at ${ms}ms did not report every position"
+        echo "$out" | grep -q 'Best move: 0000' \
+            && fail "--driver $driver --batch at ${ms}ms returned no move"
+    done
+
+    echo "$out" | grep -q 'Best move: a1a8 | Evaluation: Mate in 1' \
+        || fail "--driver $driver missed the mate in 1"
+done
+
+# Tablebases: a path holding no tables leaves probing off, and searches
+# ending on a mate, which do not depend on the speed of the machine, give
+# the same results as without the option
+tbdir=$(mktemp -d)
+found=$("$ENGINE" --syzygy-path "$tbdir" --batch /dev/null 1 2>&1)
+echo "$found" | grep -q 'Found 0-piece tablebases' \
+    || fail "--syzygy-path without tables reported '$found'"
+
+plain=$("$ENGINE" --threads 1 --batch "$DIR/tablebases.fen" 2000)
+empty=$("$ENGINE" --threads 1 --syzygy-path "$tbdir" --batch "$DIR/tablebases.fen" 2000 2>/dev/null)
+[ "$plain" = "$empty" ] || fail "--syzygy-path without tables changed the search results"
+rmdir "$tbdir"
+
+# With the KRvK tables in $SYZYGY_PATH, the root probe keeps only the move
+# saving the draw, taking the rook, and wins the other side's position
+if [ -n "$SYZYGY_PATH" ]; then
+    fen=$(mktemp)
+    printf '%s\n' '8/8/8/8/8/8/2k5/K1R5 b - - 0 1' > "$fen"
+    "$ENGINE" --syzygy-path "$SYZYGY_PATH" --batch "$fen" 100 2>/dev/null \
+        | grep -q 'Best move: c2c1 | Evaluation: 0 | Depth: 0' \
+        || fail "KRvK root probe did not keep only the drawing capture"
+
+    printf '%s\n' '8/8/8/8/8/1k6/8/1K5R w - - 0 1' > "$fen"
+    "$ENGINE" --syzygy-path "$SYZYGY_PATH" --batch "$fen" 100 2>/dev/null \
+        | grep -Eq 'Evaluation: (Tablebase win|Mate in)' \
+        || fail "KRvK root probe did not score the position as won"
+    rm -f "$fen"
+fi
+
+if [ $failures -ne 0 ]; then
+    echo "$failures check(s) failed"
+    exit 1
+fi
+echo "All checks passed"